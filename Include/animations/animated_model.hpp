@@ -1,6 +1,7 @@
 #pragma once
 
 #include "animated_mesh.hpp"
+#include "core/bounds.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -21,7 +22,8 @@ public:
     AnimatedModel()
     {
         defaultBoneMatrices.resize(100, glm::mat4(1.0f));
-        finalBoneMatrices = std::make_shared<std::vector<glm::mat4>>(defaultBoneMatrices);
+        defaultPose = std::make_shared<std::vector<glm::mat4>>(defaultBoneMatrices);
+        finalBoneMatrices = defaultPose;
     }
 
     ~AnimatedModel() = default;
@@ -32,6 +34,9 @@ public:
 
     std::vector<std::unique_ptr<AnimatedMesh>> meshes;
 
+    // Bounds of every vertex in the bind pose, computed when loading
+    AABB bounds = AABB::Empty();
+
     std::map<std::string, int> boneMapping;
     int boneCount = 0;
 
@@ -39,6 +44,9 @@ public:
     std::vector<glm::mat4> defaultBoneMatrices;
     std::shared_ptr<std::vector<glm::mat4>> finalBoneMatrices;
 
+    // Shared copy of defaultBoneMatrices, so unbinding every frame does not allocate
+    std::shared_ptr<std::vector<glm::mat4>> defaultPose;
+
     void BindAnimation(const std::shared_ptr<std::vector<glm::mat4>> &animationMatrices)
     {
         finalBoneMatrices = animationMatrices;
@@ -46,7 +54,7 @@ public:
 
     void UnbindAnimation()
     {
-        finalBoneMatrices = std::make_shared<std::vector<glm::mat4>>(defaultBoneMatrices);
+        finalBoneMatrices = defaultPose;
     }
 
     const std::vector<glm::mat4> &GetFinalBoneMatrices() const
@@ -8,7 +8,7 @@
 #include <memory>
 #include <utility>
 
-class AnimationsSystem : public System
+class AnimationsSystem : public System<AnimationComponent, AnimatedModelComponent>
 {
 public:
     std::shared_ptr<Coordinator> gCoordinator;
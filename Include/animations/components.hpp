@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/ecs/snapshot.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -27,4 +28,39 @@ struct AnimationComponent
     AnimationComponent() = default;
     AnimationComponent(std::shared_ptr<Animation> anim)
         : animation(anim) {}
+};
+
+template <>
+struct SnapshotTraits<AnimatedModelComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const AnimatedModelComponent &component)
+    {
+        return WriteAssetRef(writer, assets, component.model);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, AnimatedModelComponent &component)
+    {
+        return ReadAssetRef(reader, assets, component.model);
+    }
+};
+
+template <>
+struct SnapshotTraits<AnimationComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const AnimationComponent &component)
+    {
+        writer.Write(component.currentTime);
+        writer.Write(static_cast<std::uint8_t>(component.playing ? 1 : 0));
+        return WriteAssetRef(writer, assets, component.animation);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, AnimationComponent &component)
+    {
+        std::uint8_t playing = 0;
+        if (!reader.Read(component.currentTime) || !reader.Read(playing))
+            return false;
+
+        component.playing = playing != 0;
+        return ReadAssetRef(reader, assets, component.animation);
+    }
 };
\ No newline at end of file
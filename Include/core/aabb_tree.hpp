@@ -0,0 +1,248 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "ecs/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Dynamic bounding volume hierarchy of entity bounds. Leaves store the exact bounds of a
+// proxy and a fattened copy the tree is built from, so small movements only replace the
+// exact bounds. Leaves are placed by surface area cost and the tree is kept balanced with
+// rotations, so queries stay logarithmic while proxies come and go.
+//
+// Queries are const and may run concurrently with each other, but not with changes.
+class AABBTree
+{
+public:
+    static constexpr std::int32_t NULL_NODE = -1;
+
+    // margin is how far each side of a proxy's bounds is fattened
+    explicit AABBTree(float margin = 0.1f) : mMargin(margin) {}
+
+    std::int32_t CreateProxy(const AABB &bounds, Entity entity);
+    void DestroyProxy(std::int32_t proxy);
+
+    // Adds count proxies at once and rebuilds the whole tree top down, writing their ids
+    // to proxies. Much faster than CreateProxy one by one when adding many, e.g. on load.
+    void CreateProxies(const AABB *bounds, const Entity *entities, std::size_t count, std::int32_t *proxies);
+
+    // Rebuilds the hierarchy from scratch by splitting at the median along the widest axis
+    void Rebuild();
+
+    // Sets a proxy's exact bounds. The tree is only restructured when they leave the
+    // fattened bounds, or shrank well inside them. Returns whether it was.
+    bool MoveProxy(std::int32_t proxy, const AABB &bounds);
+
+    void Clear();
+
+    Entity GetEntity(std::int32_t proxy) const { return mNodes[proxy].entity; }
+    const AABB &GetBounds(std::int32_t proxy) const { return mBounds[proxy]; }
+    std::size_t GetProxyCount() const { return mProxyCount; }
+
+    // Height of the root, 0 for a single proxy
+    int GetHeight() const { return mRoot == NULL_NODE ? 0 : mNodes[mRoot].height; }
+
+    // Calls func(entity, bounds) for every proxy whose exact bounds overlap box
+    template <typename Func>
+    void QueryBox(const AABB &box, Func &&func) const
+    {
+        Query([&box](const AABB &node)
+              { return node.Intersects(box); },
+              [this, &box, &func](std::int32_t leaf)
+              {
+                  if (mBounds[leaf].Intersects(box))
+                      func(mNodes[leaf].entity, mBounds[leaf]);
+              });
+    }
+
+    // Calls func(entity, bounds) for every proxy whose exact bounds are within radius of center
+    template <typename Func>
+    void QuerySphere(const glm::vec3 &center, float radius, Func &&func) const
+    {
+        const float radiusSquared = radius * radius;
+        Query([&center, radiusSquared](const AABB &node)
+              { return node.DistanceSquared(center) <= radiusSquared; },
+              [this, &center, radiusSquared, &func](std::int32_t leaf)
+              {
+                  if (mBounds[leaf].DistanceSquared(center) <= radiusSquared)
+                      func(mNodes[leaf].entity, mBounds[leaf]);
+              });
+    }
+
+    // Calls func(entity, bounds) for every proxy whose exact bounds intersect the frustum.
+    // Subtrees fully inside the frustum are reported without testing each leaf.
+    template <typename Func>
+    void QueryFrustum(const Frustum &frustum, Func &&func) const
+    {
+        if (mRoot == NULL_NODE)
+            return;
+
+        NodeStack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            std::int32_t index = stack.Pop();
+            const Node &node = mNodes[index];
+            if (node.IsLeaf())
+            {
+                if (frustum.Intersects(mBounds[index]))
+                    func(node.entity, mBounds[index]);
+            }
+            else if (frustum.Contains(node.fat))
+            {
+                ReportAll(node, func);
+            }
+            else if (frustum.Intersects(node.fat))
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    // Search heaps of QueryNearest. Owned by the caller like the output, so a query reusing
+    // them does not allocate once they have grown, and concurrent queries each pass their own.
+    struct NearestScratch
+    {
+        std::vector<std::pair<float, std::int32_t>> open;
+        std::vector<std::pair<float, std::int32_t>> best;
+    };
+
+    // The k proxies with exact bounds closest to point, nearest first
+    void QueryNearest(const glm::vec3 &point, std::size_t k, std::vector<Entity> &out, NearestScratch &scratch) const;
+
+private:
+    // Only what traversal touches, exact leaf bounds are kept apart in mBounds
+    struct Node
+    {
+        // Bounds the tree is built from, for leaves the fattened exact bounds
+        AABB fat;
+
+        // Next free node while the node is on the free list
+        std::int32_t parent = NULL_NODE;
+        std::int32_t child1 = NULL_NODE;
+        std::int32_t child2 = NULL_NODE;
+
+        // 0 for leaves, -1 for free nodes
+        std::int32_t height = 0;
+
+        Entity entity = NULL_ENTITY;
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    // Traversal stack that only touches the heap for trees deeper than any balanced
+    // tree of realistic size, so queries do not allocate
+    class NodeStack
+    {
+    public:
+        void Push(std::int32_t node)
+        {
+            if (mSize < INLINE_SIZE)
+                mInline[mSize] = node;
+            else
+                mOverflow.push_back(node);
+            ++mSize;
+        }
+
+        std::int32_t Pop()
+        {
+            --mSize;
+            if (mSize < INLINE_SIZE)
+                return mInline[mSize];
+
+            std::int32_t node = mOverflow.back();
+            mOverflow.pop_back();
+            return node;
+        }
+
+        bool Empty() const { return mSize == 0; }
+
+    private:
+        static constexpr std::size_t INLINE_SIZE = 128;
+        std::int32_t mInline[INLINE_SIZE];
+        std::vector<std::int32_t> mOverflow;
+        std::size_t mSize = 0;
+    };
+
+    // Depth first walk descending into nodes accepted by visitNode, calling visitLeaf on leaves
+    template <typename NodeTest, typename LeafVisitor>
+    void Query(NodeTest &&visitNode, LeafVisitor &&visitLeaf) const
+    {
+        if (mRoot == NULL_NODE)
+            return;
+
+        NodeStack stack;
+        stack.Push(mRoot);
+        while (!stack.Empty())
+        {
+            std::int32_t index = stack.Pop();
+            const Node &node = mNodes[index];
+            if (!visitNode(node.fat))
+                continue;
+
+            if (node.IsLeaf())
+            {
+                visitLeaf(index);
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    template <typename Func>
+    void ReportAll(const Node &subtree, Func &func) const
+    {
+        NodeStack stack;
+        stack.Push(subtree.child1);
+        stack.Push(subtree.child2);
+        while (!stack.Empty())
+        {
+            std::int32_t index = stack.Pop();
+            const Node &node = mNodes[index];
+            if (node.IsLeaf())
+            {
+                func(node.entity, mBounds[index]);
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    std::int32_t AllocateNode();
+    void FreeNode(std::int32_t node);
+
+    // Places leaf in the subtree under start, the root if start is NULL_NODE
+    void InsertLeaf(std::int32_t leaf, std::int32_t start = NULL_NODE);
+
+    // Unlinks leaf and returns the node that took its parent's place
+    std::int32_t RemoveLeaf(std::int32_t leaf);
+
+    // Refits boxes and heights from node towards the root, rotating where unbalanced.
+    // Stops early once a node comes out unchanged, nothing above it can change then.
+    void FixUpwards(std::int32_t node);
+
+    // Builds a subtree over leaves[begin, end) and returns its root
+    std::int32_t BuildTopDown(std::vector<std::int32_t> &leaves, std::size_t begin, std::size_t end);
+
+    // Rotates node's taller grandchild up if its children differ in height by more than one,
+    // returns the node now at node's position
+    std::int32_t Balance(std::int32_t node);
+
+    std::vector<Node> mNodes;
+
+    // Exact bounds of each leaf, index-aligned with mNodes
+    std::vector<AABB> mBounds;
+    std::int32_t mRoot = NULL_NODE;
+    std::int32_t mFreeList = NULL_NODE;
+    std::size_t mProxyCount = 0;
+    float mMargin;
+};
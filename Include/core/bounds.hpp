@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis aligned bounding box
+struct AABB
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    // Box containing nothing, grows to the first point added
+    static AABB Empty()
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        return {glm::vec3(inf), glm::vec3(-inf)};
+    }
+
+    static AABB Merge(const AABB &a, const AABB &b)
+    {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
+
+    bool IsEmpty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    void Grow(const glm::vec3 &point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+    // Used as the insertion cost in the AABB tree
+    float SurfaceArea() const
+    {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    AABB Expanded(float margin) const
+    {
+        return {min - glm::vec3(margin), max + glm::vec3(margin)};
+    }
+
+    bool Contains(const AABB &other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+
+    bool Intersects(const AABB &other) const
+    {
+        return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z &&
+               max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+    }
+
+    // Squared distance from point to the closest point of the box, 0 inside
+    float DistanceSquared(const glm::vec3 &point) const
+    {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    // Bounds of the box after an affine transform, from the transformed center and the
+    // absolute matrix applied to the extents, so no corners need to be enumerated
+    AABB Transformed(const glm::mat4 &matrix) const
+    {
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+        glm::vec3 extents = Extents();
+        glm::vec3 worldExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+                                 glm::abs(glm::vec3(matrix[1])) * extents.y +
+                                 glm::abs(glm::vec3(matrix[2])) * extents.z;
+        return {center - worldExtents, center + worldExtents};
+    }
+};
+
+// Six planes facing inward, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    // Extracts the planes of a projection * view matrix (Gribb/Hartmann)
+    static Frustum FromMatrix(const glm::mat4 &viewProjection)
+    {
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0;
+        frustum.planes[1] = row3 - row0;
+        frustum.planes[2] = row3 + row1;
+        frustum.planes[3] = row3 - row1;
+        frustum.planes[4] = row3 + row2;
+        frustum.planes[5] = row3 - row2;
+        for (glm::vec4 &plane : frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    // Conservative, a box near a frustum corner may be reported as intersecting
+    bool Intersects(const AABB &box) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            // Corner furthest along the plane normal
+            glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                             plane.y >= 0.0f ? box.max.y : box.min.y,
+                             plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    bool Contains(const AABB &box) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            // Corner furthest against the plane normal
+            glm::vec3 corner(plane.x >= 0.0f ? box.min.x : box.max.x,
+                             plane.y >= 0.0f ? box.min.y : box.max.y,
+                             plane.z >= 0.0f ? box.min.z : box.max.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "component_manager.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Handle to an entity created through a CommandBuffer. It only becomes a real
+// Entity when the buffer is flushed, so it can be handed out from any thread.
+struct DeferredEntity
+{
+    std::uint32_t index;
+};
+
+// Records structural changes (create/destroy entities, add/remove components)
+// so they can be applied in one batch by Coordinator::Flush. Recording is
+// thread safe, so systems running on worker threads can queue changes during
+// a frame and the main thread applies them at a sync point.
+class CommandBuffer
+{
+public:
+    DeferredEntity CreateEntity()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        DeferredEntity entity{mDeferredCount++};
+        mCommands.push_back({CommandType::Create, entity.index, true, nullptr});
+        return entity;
+    }
+
+    void DestroyEntity(Entity entity)
+    {
+        Record({CommandType::Destroy, entity, false, nullptr});
+    }
+
+    void DestroyEntity(DeferredEntity entity)
+    {
+        Record({CommandType::Destroy, entity.index, true, nullptr});
+    }
+
+    template <typename T>
+    void AddComponent(Entity entity, T component)
+    {
+        Record({CommandType::Add, entity, false, std::make_unique<AddComponentOp<T>>(std::move(component))});
+    }
+
+    template <typename T>
+    void AddComponent(DeferredEntity entity, T component)
+    {
+        Record({CommandType::Add, entity.index, true, std::make_unique<AddComponentOp<T>>(std::move(component))});
+    }
+
+    template <typename T>
+    void RemoveComponent(Entity entity)
+    {
+        Record({CommandType::Remove, entity, false, std::make_unique<RemoveComponentOp<T>>()});
+    }
+
+    template <typename T>
+    void RemoveComponent(DeferredEntity entity)
+    {
+        Record({CommandType::Remove, entity.index, true, std::make_unique<RemoveComponentOp<T>>()});
+    }
+
+    bool Empty()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCommands.empty();
+    }
+
+private:
+    friend class Coordinator;
+
+    enum class CommandType : std::uint8_t
+    {
+        Create,
+        Destroy,
+        Add,
+        Remove
+    };
+
+    // Type erased component change, applied straight to the component arrays.
+    // Returns the component type it touched so the signature can be updated.
+    class ComponentOp
+    {
+    public:
+        virtual ~ComponentOp() = default;
+        virtual ComponentType Apply(ComponentManager &componentManager, Entity entity) = 0;
+    };
+
+    template <typename T>
+    class AddComponentOp : public ComponentOp
+    {
+    public:
+        explicit AddComponentOp(T component) : mComponent(std::move(component)) {}
+
+        ComponentType Apply(ComponentManager &componentManager, Entity entity) override
+        {
+            componentManager.EmplaceComponent<T>(entity, std::move(mComponent));
+            return componentManager.GetComponentType<T>();
+        }
+
+    private:
+        T mComponent;
+    };
+
+    template <typename T>
+    class RemoveComponentOp : public ComponentOp
+    {
+    public:
+        ComponentType Apply(ComponentManager &componentManager, Entity entity) override
+        {
+            componentManager.RemoveComponent<T>(entity);
+            return componentManager.GetComponentType<T>();
+        }
+    };
+
+    struct Command
+    {
+        CommandType type;
+        // Entity, or index of a DeferredEntity when deferred is set
+        Entity entity;
+        bool deferred;
+        std::unique_ptr<ComponentOp> op;
+    };
+
+    void Record(Command command)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCommands.push_back(std::move(command));
+    }
+
+    // Hands the recorded commands to the caller and resets the buffer for the next frame
+    std::vector<Command> Take(std::uint32_t &deferredCount)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        deferredCount = mDeferredCount;
+        mDeferredCount = 0;
+        return std::exchange(mCommands, {});
+    }
+
+    std::mutex mMutex;
+    std::vector<Command> mCommands;
+    std::uint32_t mDeferredCount = 0;
+};
@@ -1,7 +1,15 @@
 #pragma once
 
 #include "types.hpp"
-#include <unordered_map>
+#include "entity_manager.hpp"
+#include "entity_set.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 #include <memory>
 #include <iostream>
 #include <cassert>
@@ -11,78 +19,538 @@ class IComponentArray
 public:
     virtual ~IComponentArray() = default;
     virtual void EntityDestroyed(Entity entity) = 0;
+    virtual void SetChangeTick(ChangeTick tick) = 0;
+    virtual void Clear() = 0;
+
+    // Snapshot support, see snapshot.hpp
+    virtual bool SupportsSnapshot() const = 0;
+    virtual std::uint64_t LayoutKey() const = 0;
+    virtual bool WriteSnapshot(SnapshotWriter &writer, const AssetRegistry &assets) = 0;
+
+    // Parses one column written by WriteSnapshot without touching the array. Returns the
+    // function that installs it, or an empty function if the data is invalid. The column must
+    // list exactly the expectedCount entities alive in entityManager with type in their
+    // signature, each once. The returned function may point into the reader's buffer, call it
+    // before that buffer goes away.
+    virtual std::function<void()> ReadSnapshot(SnapshotReader &reader, const AssetRegistry &assets,
+                                               const EntityManager &entityManager, ComponentType type,
+                                               std::size_t expectedCount) = 0;
 };
 
+// Whether a snapshot column's entities can be installed: each alive in entityManager with
+// type in its signature, and no slot index listed twice
+inline bool ValidSnapshotEntities(const char *entities, std::size_t count, const EntityManager &entityManager, ComponentType type)
+{
+    std::vector<bool> seen;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Entity entity;
+        std::memcpy(&entity, entities + i * sizeof(Entity), sizeof(Entity));
+        if (!entityManager.IsAlive(entity) || !entityManager.GetSignature(entity).test(type))
+            return false;
+
+        Entity index = EntityIndex(entity);
+        if (index >= seen.size())
+            seen.resize(index + 1, false);
+        if (seen[index])
+            return false;
+        seen[index] = true;
+    }
+    return true;
+}
+
+// Number of components in each page of dense or sparse component storage.
+// Pages are allocated as the array grows and released again as it shrinks,
+// so memory follows the number of live components rather than the entity cap.
+const std::size_t COMPONENT_PAGE_SIZE = 1024;
+
 template <typename T>
 class ComponentArray : public IComponentArray
 {
 public:
-    void InsertData(Entity entity, T component)
+    static constexpr StoragePolicy POLICY = ComponentStorage<T>::policy;
+
+    static_assert(POLICY != StoragePolicy::Tag || (std::is_empty_v<T> && std::is_default_constructible_v<T>),
+                  "Only empty, default constructible types can be stored as tags.");
+
+    ComponentArray() = default;
+    ComponentArray(const ComponentArray &) = delete;
+    ComponentArray &operator=(const ComponentArray &) = delete;
+
+    ~ComponentArray() override
+    {
+        Release();
+    }
+
+    // Called as func(entity, component) right after a component is added, and right before
+    // one is removed, including removals from destroying the entity, Clear and snapshot loads.
+    // Observers run inline on the thread making the change and must not add or remove T.
+    using Observer = std::function<void(Entity, T &)>;
+
+    void OnAdd(Observer observer) { mOnAdd.push_back(std::move(observer)); }
+    void OnRemove(Observer observer) { mOnRemove.push_back(std::move(observer)); }
+
+    void InsertData(Entity entity, const T &component)
+    {
+        EmplaceData(entity, component);
+    }
+
+    void InsertData(Entity entity, T &&component)
+    {
+        EmplaceData(entity, std::move(component));
+    }
+
+    // Constructs the component in place from args, braced for aggregates like most components
+    template <typename... Args>
+    T &EmplaceData(Entity entity, Args &&...args)
+    {
+        assert(!HasEntity(entity) && "Component added to same entity more than once.");
+
+        // Put new entry at end, the entity set places the entity at the same packed index
+        std::size_t newIndex = mEntities.Size();
+        T *slot = Allocate(newIndex, entity);
+        if constexpr (POLICY == StoragePolicy::Tag)
+            ((void)args, ...);
+        else if constexpr (std::is_aggregate_v<T>)
+            new (slot) T{std::forward<Args>(args)...};
+        else
+            new (slot) T(std::forward<Args>(args)...);
+
+        // A new component counts as changed so incremental consumers pick it up
+        mChangeTicks.push_back(mChangeTick);
+        mEntities.Insert(entity);
+
+        for (Observer &observer : mOnAdd)
+        {
+            observer(entity, *slot);
+        }
+        return *slot;
+    }
+
+    // Appends a copy of component for each of count entities that do not have T yet. Storage
+    // and bookkeeping grow once for the whole batch, trivially copyable components are memcpy'd.
+    void InsertCopies(const Entity *entities, std::size_t count, const T &component)
     {
-        assert(mEntityToIndexMap.find(entity) == mEntityToIndexMap.end() && "Component added to same entity more than once.");
+        std::size_t first = mEntities.Size();
+        std::size_t end = first + count;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            assert(!HasEntity(entities[i]) && "Component added to same entity more than once.");
+
+            T *slot = Allocate(first + i, entities[i]);
+            if constexpr (POLICY == StoragePolicy::Tag)
+                continue;
+            else if constexpr (std::is_trivially_copyable_v<T>)
+                std::memcpy(static_cast<void *>(slot), &component, sizeof(T));
+            else
+                new (slot) T(component);
+        }
+
+        mChangeTicks.resize(end, mChangeTick);
+        mEntities.Reserve(end);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            mEntities.Insert(entities[i]);
+        }
 
-        // Put new entry at end and update the maps
-        size_t newIndex = mSize;
-        mEntityToIndexMap[entity] = newIndex;
-        mIndexToEntityMap[newIndex] = entity;
-        mComponentArray[newIndex] = component;
-        ++mSize;
+        for (Observer &observer : mOnAdd)
+        {
+            for (std::size_t i = first; i < end; ++i)
+            {
+                observer(mEntities[i], *Slot(i));
+            }
+        }
     }
 
     void RemoveData(Entity entity)
     {
-        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Removing non-existent component.");
+        assert(HasEntity(entity) && "Removing non-existent component.");
 
-        // Copy element at end into deleted element's place to maintain density
-        size_t indexOfRemovedEntity = mEntityToIndexMap[entity];
-        size_t indexOfLastElement = mSize - 1;
-        mComponentArray[indexOfRemovedEntity] = mComponentArray[indexOfLastElement];
+        for (Observer &observer : mOnRemove)
+        {
+            observer(entity, GetData(entity));
+        }
 
-        // Update map to point to moved spot
-        Entity entityOfLastElement = mIndexToEntityMap[indexOfLastElement];
-        mEntityToIndexMap[entityOfLastElement] = indexOfRemovedEntity;
-        mIndexToEntityMap[indexOfRemovedEntity] = entityOfLastElement;
+        std::size_t indexOfRemovedEntity = mEntities.IndexOf(entity);
+        std::size_t indexOfLastElement = mEntities.Size() - 1;
+        if constexpr (POLICY == StoragePolicy::Sparse)
+        {
+            // Sparse components stay where they are, only the packed entity order changes
+            SparseSlot(entity)->~T();
+            FreeSparse(entity);
+        }
+        else if constexpr (POLICY != StoragePolicy::Tag)
+        {
+            // Move element at end into deleted element's place to maintain density,
+            // the entity set does the same swap for the owning entities
+            if (indexOfRemovedEntity != indexOfLastElement)
+                *Slot(indexOfRemovedEntity) = std::move(*Slot(indexOfLastElement));
+
+            // Pop the now moved-from last element, no map erasure needed
+            Slot(indexOfLastElement)->~T();
+        }
 
-        mEntityToIndexMap.erase(entity);
-        mIndexToEntityMap.erase(indexOfLastElement);
+        mChangeTicks[indexOfRemovedEntity] = mChangeTicks[indexOfLastElement];
+        mChangeTicks.pop_back();
+        mEntities.Erase(entity);
 
-        --mSize;
+        // Keep at most one empty page around so add/remove at a page boundary does not thrash
+        if constexpr (POLICY == StoragePolicy::Dense || POLICY == StoragePolicy::Singleton)
+        {
+            std::size_t usedPages = (mEntities.Size() + PAGE_SIZE - 1) / PAGE_SIZE;
+            if (mPages.size() > usedPages + 1)
+            {
+                mAllocator.deallocate(mPages.back(), PAGE_SIZE);
+                mPages.pop_back();
+            }
+        }
     }
 
     bool HasEntity(Entity entity) const
     {
-        return mEntityToIndexMap.find(entity) != mEntityToIndexMap.end();
+        return mEntities.Contains(entity);
     }
 
     T &GetData(Entity entity)
     {
-        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Retrieving non-existent component.");
+        assert(HasEntity(entity) && "Retrieving non-existent component.");
+
+        // Sparse components are found from the entity slot alone
+        if constexpr (POLICY == StoragePolicy::Sparse)
+            return *SparseSlot(entity);
+        else
+            return *Slot(mEntities.IndexOf(entity));
+    }
+
+    // Mutable access that also marks the component as changed in the current tick.
+    // GetData does not mark anything, use this (or MarkChanged) when writing.
+    T &Patch(Entity entity)
+    {
+        assert(HasEntity(entity) && "Patching non-existent component.");
+
+        mChangeTicks[mEntities.IndexOf(entity)] = mChangeTick;
+        return GetData(entity);
+    }
+
+    void MarkChanged(Entity entity)
+    {
+        assert(HasEntity(entity) && "Marking non-existent component.");
+
+        mChangeTicks[mEntities.IndexOf(entity)] = mChangeTick;
+    }
+
+    // True if the component was added or marked changed in tick `since` or later
+    bool ChangedSince(Entity entity, ChangeTick since) const
+    {
+        assert(HasEntity(entity) && "Querying non-existent component.");
+
+        return mChangeTicks[mEntities.IndexOf(entity)] >= since;
+    }
+
+    // Calls func(entity, T&) for every component added or changed in tick `since` or later.
+    // Only the tick column is scanned, unchanged components are never touched.
+    template <typename Func>
+    void EachChangedSince(ChangeTick since, Func &&func)
+    {
+        for (std::size_t i = mEntities.Size(); i-- > 0;)
+        {
+            if (i < mEntities.Size() && mChangeTicks[i] >= since)
+                func(mEntities[i], *Slot(i));
+        }
+    }
+
+    void SetChangeTick(ChangeTick tick) override
+    {
+        mChangeTick = tick;
+    }
+
+    ChangeTick GetChangeTick() const { return mChangeTick; }
+
+    // Destroys every component and releases all storage pages
+    void Clear() override
+    {
+        for (Observer &observer : mOnRemove)
+        {
+            for (std::size_t i = 0; i < mEntities.Size(); ++i)
+            {
+                observer(mEntities[i], *Slot(i));
+            }
+        }
+        Release();
+    }
+
+    bool SupportsSnapshot() const override
+    {
+        return HasSnapshotTraits<T>::value || std::is_trivially_copyable_v<T>;
+    }
+
+    std::uint64_t LayoutKey() const override
+    {
+        // FNV-1a of the type name mixed with its size and storage, enough to reject a column
+        // from another layout
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const char *c = typeid(T).name(); *c; ++c)
+        {
+            hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+        }
+        return hash ^ sizeof(T) ^ (static_cast<std::uint64_t>(POLICY) << 32);
+    }
+
+    // Column layout: count, packed entities, then either the raw packed components
+    // or each component as written by its SnapshotTraits. Tags store no components.
+    bool WriteSnapshot(SnapshotWriter &writer, const AssetRegistry &assets) override
+    {
+        std::uint64_t count = mEntities.Size();
+        writer.Write(count);
+        writer.Write(mEntities.Data(), count * sizeof(Entity));
+
+        if constexpr (POLICY == StoragePolicy::Tag)
+        {
+            return true;
+        }
+        else if constexpr (HasSnapshotTraits<T>::value)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (!SnapshotTraits<T>::Write(writer, assets, *Slot(i)))
+                    return false;
+            }
+            return true;
+        }
+        else if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // Dense pages hold runs of packed components, the other layouts go one by one
+            std::size_t run = POLICY == StoragePolicy::Dense ? COMPONENT_PAGE_SIZE : 1;
+            for (std::size_t begin = 0; begin < count; begin += run)
+            {
+                writer.Write(Slot(begin), std::min<std::size_t>(run, count - begin) * sizeof(T));
+            }
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    std::function<void()> ReadSnapshot(SnapshotReader &reader, const AssetRegistry &assets,
+                                       const EntityManager &entityManager, ComponentType type,
+                                       std::size_t expectedCount) override
+    {
+        // With every listed entity unique, alive and carrying the bit, a matching count means
+        // no entity with the bit is missing from the column
+        std::uint64_t count = 0;
+        if (!reader.Read(count) || count != expectedCount || count > MAX_ENTITIES || (POLICY == StoragePolicy::Singleton && count > 1))
+            return {};
+
+        const char *entities = reader.Take(count * sizeof(Entity));
+        if (!entities || !ValidSnapshotEntities(entities, count, entityManager, type))
+            return {};
+
+        if constexpr (POLICY == StoragePolicy::Tag)
+        {
+            return [this, entities, count]()
+            {
+                Restore(entities, count);
+                NotifyAllAdded();
+            };
+        }
+        else if constexpr (HasSnapshotTraits<T>::value)
+        {
+            auto components = std::make_shared<std::vector<T>>(count);
+            for (T &component : *components)
+            {
+                if (!SnapshotTraits<T>::Read(reader, assets, component))
+                    return {};
+            }
+
+            return [this, entities, components]()
+            {
+                Restore(entities, components->size());
+                for (std::size_t i = 0; i < components->size(); ++i)
+                {
+                    new (Slot(i)) T(std::move((*components)[i]));
+                }
+                NotifyAllAdded();
+            };
+        }
+        else if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            const char *data = reader.Take(count * sizeof(T));
+            if (!data)
+                return {};
 
-        // Return a reference to the entity's component
-        return mComponentArray[mEntityToIndexMap[entity]];
+            return [this, entities, count, data]()
+            {
+                Restore(entities, count);
+                std::size_t run = POLICY == StoragePolicy::Dense ? COMPONENT_PAGE_SIZE : 1;
+                for (std::size_t begin = 0; begin < count; begin += run)
+                {
+                    std::size_t size = std::min<std::size_t>(run, count - begin) * sizeof(T);
+                    std::memcpy(static_cast<void *>(Slot(begin)), data + begin * sizeof(T), size);
+                }
+                NotifyAllAdded();
+            };
+        }
+        else
+        {
+            return {};
+        }
     }
 
     void EntityDestroyed(Entity entity) override
     {
-        if (mEntityToIndexMap.find(entity) != mEntityToIndexMap.end())
+        if (HasEntity(entity))
         {
             RemoveData(entity);
         }
     }
 
+    std::size_t Size() const { return mEntities.Size(); }
+
+    // Packed entities owning the components, index-aligned with GetDataAt()
+    const Entity *Entities() const { return mEntities.Data(); }
+
+    T &GetDataAt(std::size_t index) { return *Slot(index); }
+
+    ChangeTick GetChangeTickAt(std::size_t index) const { return mChangeTicks[index]; }
+
 private:
-    // The packed array of components (of generic type T),
-    // set to a specified maximum amount, matching the maximum number
-    // of entities allowed to exist simultaneously, so that each entity
-    // has a unique spot.
-    std::array<T, MAX_ENTITIES> mComponentArray;
+    // Components per page, a singleton only ever needs the one slot
+    static constexpr std::size_t PAGE_SIZE = POLICY == StoragePolicy::Singleton ? 1 : COMPONENT_PAGE_SIZE;
 
-    // Map from an entity ID to an array index.
-    std::unordered_map<Entity, size_t> mEntityToIndexMap;
+    // Clear without notifying observers
+    void Release()
+    {
+        if constexpr (POLICY != StoragePolicy::Tag)
+        {
+            for (std::size_t i = 0; i < mEntities.Size(); ++i)
+            {
+                Slot(i)->~T();
+            }
+        }
+        for (T *page : mPages)
+        {
+            if (page)
+                mAllocator.deallocate(page, PAGE_SIZE);
+        }
 
-    // Map from an array index to an entity ID.
-    std::unordered_map<size_t, Entity> mIndexToEntityMap;
+        mPages.clear();
+        mPageCounts.clear();
+        mEntities.Clear();
+        mChangeTicks.clear();
+    }
 
-    // Total size of valid entries in the array.
-    size_t mSize;
-};
\ No newline at end of file
+    void NotifyAllAdded()
+    {
+        for (Observer &observer : mOnAdd)
+        {
+            for (std::size_t i = 0; i < mEntities.Size(); ++i)
+            {
+                observer(mEntities[i], *Slot(i));
+            }
+        }
+    }
+
+    // Empties the array and prepares storage and bookkeeping for count components owned
+    // by the packed entities, leaving the component slots for the caller to construct
+    void Restore(const char *entities, std::size_t count)
+    {
+        Clear();
+
+        mChangeTicks.assign(count, mChangeTick);
+        mEntities.Reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Entity entity;
+            std::memcpy(&entity, entities + i * sizeof(Entity), sizeof(Entity));
+            Allocate(i, entity);
+            mEntities.Insert(entity);
+        }
+    }
+
+    // Makes sure there is storage for the component at packed index, owned by entity,
+    // and returns where it goes
+    T *Allocate(std::size_t index, Entity entity)
+    {
+        if constexpr (POLICY == StoragePolicy::Tag)
+        {
+            return &sTag;
+        }
+        else if constexpr (POLICY == StoragePolicy::Sparse)
+        {
+            std::size_t page = EntityIndex(entity) / COMPONENT_PAGE_SIZE;
+            if (page >= mPages.size())
+            {
+                mPages.resize(page + 1, nullptr);
+                mPageCounts.resize(page + 1, 0);
+            }
+            if (!mPages[page])
+                mPages[page] = mAllocator.allocate(COMPONENT_PAGE_SIZE);
+
+            ++mPageCounts[page];
+            return SparseSlot(entity);
+        }
+        else
+        {
+            if (index == mPages.size() * PAGE_SIZE)
+            {
+                mPages.push_back(mAllocator.allocate(PAGE_SIZE));
+            }
+            return Slot(index);
+        }
+    }
+
+    // Releases the page of a sparse component that was just destroyed once it is empty
+    void FreeSparse(Entity entity)
+    {
+        std::size_t page = EntityIndex(entity) / COMPONENT_PAGE_SIZE;
+        if (--mPageCounts[page] == 0)
+        {
+            mAllocator.deallocate(mPages[page], COMPONENT_PAGE_SIZE);
+            mPages[page] = nullptr;
+        }
+    }
+
+    T *SparseSlot(Entity entity)
+    {
+        return mPages[EntityIndex(entity) / COMPONENT_PAGE_SIZE] + EntityIndex(entity) % COMPONENT_PAGE_SIZE;
+    }
+
+    // Component at packed index
+    T *Slot(std::size_t index)
+    {
+        if constexpr (POLICY == StoragePolicy::Tag)
+            return &sTag;
+        else if constexpr (POLICY == StoragePolicy::Sparse)
+            return SparseSlot(mEntities[index]);
+        else
+            return mPages[index / PAGE_SIZE] + index % PAGE_SIZE;
+    }
+
+    // The components (of generic type T), split into fixed-size pages so growing never
+    // moves existing components. Dense and singleton pages are filled in packed order,
+    // sparse pages are indexed by entity slot and are null until an entity in range has T.
+    std::vector<T *> mPages;
+
+    // Live components in each sparse page
+    std::vector<std::uint32_t> mPageCounts;
+
+    std::allocator<T> mAllocator;
+
+    // Entity owning each packed component, index-aligned with the packed order,
+    // with the paged sparse index from an entity ID to its packed index.
+    std::conditional_t<POLICY == StoragePolicy::Singleton, SingleEntitySet, EntitySet> mEntities;
+
+    // Tick each packed component last changed in, index-aligned with mEntities
+    std::vector<ChangeTick> mChangeTicks;
+
+    // Tick stamped on changes made now, starts at 1 so "changed since 0" means everything
+    ChangeTick mChangeTick = 1;
+
+    std::vector<Observer> mOnAdd;
+    std::vector<Observer> mOnRemove;
+
+    // What every entity with a tag gets handed, tags have no state to keep apart
+    inline static T sTag{};
+};
@@ -1,91 +1,256 @@
 #pragma once
 
 #include "component_array.hpp"
-#include <unordered_map>
+#include "view.hpp"
+#include <array>
+#include <functional>
+#include <iostream>
 #include <memory>
+#include <utility>
 #include <cassert>
 
+using ComponentFamily = TypeFamily<struct ComponentFamilyTag>;
+
 class ComponentManager
 {
 public:
     template <typename T>
     void RegisterComponent()
     {
-        const char *typeName = typeid(T).name();
-
-        assert(mComponentTypes.find(typeName) == mComponentTypes.end() && "Registering component type more than once.");
+        std::uint32_t type = ComponentTypeOf<T>();
 
-        mComponentTypes.insert({typeName, mNextComponentType});
+        assert(type < MAX_COMPONENTS && "Too many component types.");
+        assert(!mComponentArrays[type] && "Registering component type more than once.");
 
-        mComponentArrays.insert({typeName, std::make_shared<ComponentArray<T>>()});
-
-        ++mNextComponentType;
+        mComponentArrays[type] = std::make_unique<ComponentArray<T>>();
+        mComponentArrays[type]->SetChangeTick(mChangeTick);
     }
 
     template <typename T>
     ComponentType GetComponentType()
     {
-        const char *typeName = typeid(T).name();
+        std::uint32_t type = ComponentTypeOf<T>();
+
+        assert(type < MAX_COMPONENTS && mComponentArrays[type] && "Component not registered before use.");
 
-        assert(mComponentTypes.find(typeName) != mComponentTypes.end() && "Component not registered before use.");
+        return static_cast<ComponentType>(type);
+    }
 
-        return mComponentTypes[typeName];
+    template <typename T, typename... Args>
+    T &EmplaceComponent(Entity entity, Args &&...args)
+    {
+        return GetComponentArray<T>().EmplaceData(entity, std::forward<Args>(args)...);
     }
 
+    // Gives each of count entities a copy of component, see ComponentArray::InsertCopies
     template <typename T>
-    void AddComponent(Entity entity, T component)
+    void AddComponents(const Entity *entities, std::size_t count, const T &component)
     {
-        GetComponentArray<T>()->InsertData(entity, component);
+        GetComponentArray<T>().InsertCopies(entities, count, component);
     }
 
     template <typename T>
     void RemoveComponent(Entity entity)
     {
-        GetComponentArray<T>()->RemoveData(entity);
+        GetComponentArray<T>().RemoveData(entity);
     }
 
     template <typename T>
     T &GetComponent(Entity entity)
     {
-        return GetComponentArray<T>()->GetData(entity);
+        return GetComponentArray<T>().GetData(entity);
+    }
+
+    template <typename T>
+    T &PatchComponent(Entity entity)
+    {
+        return GetComponentArray<T>().Patch(entity);
+    }
+
+    template <typename T>
+    void MarkChanged(Entity entity)
+    {
+        GetComponentArray<T>().MarkChanged(entity);
+    }
+
+    template <typename T>
+    bool ChangedSince(Entity entity, ChangeTick since)
+    {
+        return GetComponentArray<T>().ChangedSince(entity, since);
+    }
+
+    // Observers for T being added to or removed from an entity, see ComponentArray::Observer
+    template <typename T>
+    void OnAdd(typename ComponentArray<T>::Observer observer)
+    {
+        GetComponentArray<T>().OnAdd(std::move(observer));
+    }
+
+    template <typename T>
+    void OnRemove(typename ComponentArray<T>::Observer observer)
+    {
+        GetComponentArray<T>().OnRemove(std::move(observer));
     }
 
     template <typename T>
     bool HasComponent(Entity entity)
     {
-        const char *typeName = typeid(T).name();
-        auto it = mComponentArrays.find(typeName);
-        if (it == mComponentArrays.end())
+        std::uint32_t type = ComponentTypeOf<T>();
+        if (type >= MAX_COMPONENTS || !mComponentArrays[type])
             return false;
 
-        auto componentArray = std::static_pointer_cast<ComponentArray<T>>(it->second);
-        return componentArray->HasEntity(entity);
+        return static_cast<ComponentArray<T> *>(mComponentArrays[type].get())->HasEntity(entity);
     }
 
-    void EntityDestroyed(Entity entity)
+    template <typename... Ts>
+    ComponentView<Ts...> View()
+    {
+        return ComponentView<Ts...>(GetComponentArray<Ts>()...);
+    }
+
+    // Starts a new tick, changes from here on are stamped with the returned value
+    ChangeTick AdvanceChangeTick()
     {
-        for (auto const &pair : mComponentArrays)
+        ++mChangeTick;
+        for (auto const &component : mComponentArrays)
         {
-            auto const &component = pair.second;
+            if (component)
+                component->SetChangeTick(mChangeTick);
+        }
+        return mChangeTick;
+    }
 
-            component->EntityDestroyed(entity);
+    ChangeTick GetChangeTick() const { return mChangeTick; }
+
+    // Component types whose arrays are written to snapshots
+    Signature GetSnapshotTypes() const
+    {
+        Signature types;
+        for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+        {
+            if (mComponentArrays[type] && mComponentArrays[type]->SupportsSnapshot())
+                types.set(type);
         }
+        return types;
     }
 
-private:
-    std::unordered_map<const char *, ComponentType> mComponentTypes{};
+    // Writes the column count followed by, for each supported array, its type,
+    // layout key and column
+    bool WriteSnapshot(SnapshotWriter &writer, const AssetRegistry &assets)
+    {
+        writer.Write(static_cast<std::uint32_t>(GetSnapshotTypes().count()));
+        for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+        {
+            auto const &component = mComponentArrays[type];
+            if (!component || !component->SupportsSnapshot())
+                continue;
+
+            writer.Write(static_cast<std::uint32_t>(type));
+            writer.Write(component->LayoutKey());
+            if (!component->WriteSnapshot(writer, assets))
+            {
+                std::cerr << "Snapshot: component type " << type << " references an unregistered asset" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Parses every column without changing anything. The returned function clears all
+    // arrays and installs the parsed columns, it is empty if the data does not match the
+    // registered component types or the entities and signatures of entityManager. On success
+    // restoredTypes holds the types of the parsed columns, every other array comes back empty.
+    std::function<void()> ReadSnapshot(SnapshotReader &reader, const AssetRegistry &assets, const EntityManager &entityManager,
+                                       Signature &restoredTypes)
+    {
+        std::uint32_t columnCount = 0;
+        if (!reader.Read(columnCount) || columnCount > MAX_COMPONENTS)
+            return {};
+
+        // Living entities claiming each type, a column has to list exactly these
+        std::array<std::size_t, MAX_COMPONENTS> claimed{};
+        entityManager.EachLiving([&claimed, &entityManager](Entity entity)
+                                 {
+                                     Signature signature = entityManager.GetSignature(entity);
+                                     for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+                                     {
+                                         if (signature.test(type))
+                                             ++claimed[type];
+                                     }
+                                 });
 
-    std::unordered_map<const char *, std::shared_ptr<IComponentArray>> mComponentArrays{};
+        Signature parsed;
 
-    ComponentType mNextComponentType{};
+        std::vector<std::function<void()>> restores;
+        for (std::uint32_t column = 0; column < columnCount; ++column)
+        {
+            std::uint32_t type = 0;
+            std::uint64_t layoutKey = 0;
+            if (!reader.Read(type) || !reader.Read(layoutKey))
+                return {};
+
+            if (type >= MAX_COMPONENTS || !mComponentArrays[type] || mComponentArrays[type]->LayoutKey() != layoutKey)
+            {
+                std::cerr << "Snapshot: component type " << type << " does not match the registered components" << std::endl;
+                return {};
+            }
+            if (parsed.test(type))
+            {
+                std::cerr << "Snapshot: component type " << type << " appears more than once" << std::endl;
+                return {};
+            }
+            parsed.set(type);
+
+            auto restore = mComponentArrays[type]->ReadSnapshot(reader, assets, entityManager, static_cast<ComponentType>(type), claimed[type]);
+            if (!restore)
+            {
+                std::cerr << "Snapshot: component type " << type << " could not be read" << std::endl;
+                return {};
+            }
+            restores.push_back(std::move(restore));
+        }
+
+        restoredTypes = parsed;
+        return [this, restores = std::move(restores)]()
+        {
+            for (auto const &component : mComponentArrays)
+            {
+                if (component)
+                    component->Clear();
+            }
+            for (auto const &restore : restores)
+            {
+                restore();
+            }
+        };
+    }
+
+    void EntityDestroyed(Entity entity)
+    {
+        for (auto const &component : mComponentArrays)
+        {
+            if (component)
+                component->EntityDestroyed(entity);
+        }
+    }
+
+private:
+    // Indexed by component type, empty for types that were never registered
+    std::array<std::unique_ptr<IComponentArray>, MAX_COMPONENTS> mComponentArrays{};
+
+    ChangeTick mChangeTick = 1;
 
     template <typename T>
-    std::shared_ptr<ComponentArray<T>> GetComponentArray()
+    static std::uint32_t ComponentTypeOf()
     {
-        const char *typeName = typeid(T).name();
+        return ComponentFamily::Id<T>();
+    }
 
-        assert(mComponentTypes.find(typeName) != mComponentTypes.end() && "Component not registered before use.");
+    template <typename T>
+    ComponentArray<T> &GetComponentArray()
+    {
+        ComponentType type = GetComponentType<T>();
 
-        return std::static_pointer_cast<ComponentArray<T>>(mComponentArrays[typeName]);
+        return *static_cast<ComponentArray<T> *>(mComponentArrays[type].get());
     }
-};
\ No newline at end of file
+};
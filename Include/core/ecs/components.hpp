@@ -1,5 +1,8 @@
 #pragma once
 
+#include "types.hpp"
+#include "snapshot.hpp"
+#include "../bounds.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -28,6 +31,27 @@ struct TransformComponent
     }
 };
 
+// Makes the entity's transform relative to its parent's world transform. Reparenting
+// must go through Coordinator::PatchComponent so the TransformSystem notices it.
+struct HierarchyComponent
+{
+    Entity parent = NULL_ENTITY;
+};
+
+// World transform computed by the TransformSystem from the entity's transform and
+// its parents, read by rendering instead of recomputing TransformComponent::GetMatrix()
+struct WorldMatrixComponent
+{
+    glm::mat4 matrix{1.0f};
+};
+
+// Local space bounds for the SpatialIndexSystem, for entities without a model
+// or to override the model's bounds
+struct BoundsComponent
+{
+    AABB bounds;
+};
+
 struct ModelComponent
 {
     std::shared_ptr<Model> model;
@@ -44,6 +68,34 @@ struct MaterialComponent
     MaterialComponent(std::shared_ptr<Material> m) { materials.push_back(m); }
 };
 
+template <>
+struct SnapshotTraits<ModelComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const ModelComponent &component)
+    {
+        return WriteAssetRef(writer, assets, component.model);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, ModelComponent &component)
+    {
+        return ReadAssetRef(reader, assets, component.model);
+    }
+};
+
+template <>
+struct SnapshotTraits<MaterialComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const MaterialComponent &component)
+    {
+        return WriteAssetRefs(writer, assets, component.materials);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, MaterialComponent &component)
+    {
+        return ReadAssetRefs(reader, assets, component.materials);
+    }
+};
+
 struct PointLightComponent
 {
     glm::vec3 color = glm::vec3(1.0f);
@@ -1,16 +1,28 @@
 #pragma once
 
 #include "component_manager.hpp"
+#include "command_buffer.hpp"
 #include "entity_manager.hpp"
+#include "prefab.hpp"
 #include "system.hpp"
+#include "snapshot.hpp"
+#include "../job_system.hpp"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 class Coordinator {
 public:
-    void Init() {
+    // maxEntities caps how many entities may be alive at once; component storage
+    // is allocated on demand, so a large cap costs nothing until entities exist
+    void Init(Entity maxEntities = DEFAULT_MAX_ENTITIES) {
         // Create pointers to each manager
+        mJobSystem = std::make_unique<JobSystem>();
         mComponentManager = std::make_unique<ComponentManager>();
-        mEntityManager = std::make_unique<EntityManager>();
-        mSystemManager = std::make_unique<SystemManager>();
+        mEntityManager = std::make_unique<EntityManager>(maxEntities);
+        mSystemManager = std::make_unique<SystemManager>(*mJobSystem);
     }
 
     // Entity methods
@@ -26,6 +38,11 @@ public:
         mSystemManager->EntityDestroyed(entity);
     }
 
+    // False once the entity has been destroyed, even if its slot was reused since
+    bool IsAlive(Entity entity) const {
+        return mEntityManager->IsAlive(entity);
+    }
+
     // Component methods
     template<typename T>
     void RegisterComponent() {
@@ -33,25 +50,42 @@ public:
     }
 
     template<typename T>
-    void AddComponent(Entity entity, T component) {
-        mComponentManager->AddComponent<T>(entity, component);
+    void AddComponent(Entity entity, const T& component) {
+        EmplaceComponent<T>(entity, component);
+    }
+
+    // Moves temporaries straight into storage, so shared pointers and vectors inside
+    // components are not copied on the way in
+    template<typename T, typename = std::enable_if_t<!std::is_reference_v<T>>>
+    void AddComponent(Entity entity, T&& component) {
+        EmplaceComponent<T>(entity, std::move(component));
+    }
+
+    // Constructs the component in its final slot from args. The returned reference is
+    // valid until the next removal of a T.
+    template<typename T, typename... Args>
+    T& EmplaceComponent(Entity entity, Args&&... args) {
+        T& component = mComponentManager->EmplaceComponent<T>(entity, std::forward<Args>(args)...);
 
+        ComponentType type = mComponentManager->GetComponentType<T>();
         auto signature = mEntityManager->GetSignature(entity);
-        signature.set(mComponentManager->GetComponentType<T>(), true);
+        signature.set(type, true);
         mEntityManager->SetSignature(entity, signature);
 
-        mSystemManager->EntitySignatureChanged(entity, signature);
+        mSystemManager->EntitySignatureChanged(entity, signature, Signature().set(type));
+        return component;
     }
 
     template<typename T>
     void RemoveComponent(Entity entity) {
         mComponentManager->RemoveComponent<T>(entity);
 
+        ComponentType type = mComponentManager->GetComponentType<T>();
         auto signature = mEntityManager->GetSignature(entity);
-        signature.set(mComponentManager->GetComponentType<T>(), false);
+        signature.set(type, false);
         mEntityManager->SetSignature(entity, signature);
 
-        mSystemManager->EntitySignatureChanged(entity, signature);
+        mSystemManager->EntitySignatureChanged(entity, signature, Signature().set(type));
     }
 
     template<typename T>
@@ -59,6 +93,39 @@ public:
         return mComponentManager->GetComponent<T>(entity);
     }
 
+    // Like GetComponent, but marks the component as changed for incremental consumers
+    template<typename T>
+    T& PatchComponent(Entity entity) {
+        return mComponentManager->PatchComponent<T>(entity);
+    }
+
+    template<typename T>
+    void MarkChanged(Entity entity) {
+        mComponentManager->MarkChanged<T>(entity);
+    }
+
+    // True if the entity's T was added or changed in tick `since` or later
+    template<typename T>
+    bool ChangedSince(Entity entity, ChangeTick since) {
+        return mComponentManager->ChangedSince<T>(entity, since);
+    }
+
+    ChangeTick GetChangeTick() const {
+        return mComponentManager->GetChangeTick();
+    }
+
+    // Lets a subsystem keep its own index of entities with T, e.g.
+    // coordinator->OnAdd<PointLightComponent>([&](Entity e, PointLightComponent&) { lights.Insert(e); });
+    template<typename T>
+    void OnAdd(std::function<void(Entity, T&)> observer) {
+        mComponentManager->OnAdd<T>(std::move(observer));
+    }
+
+    template<typename T>
+    void OnRemove(std::function<void(Entity, T&)> observer) {
+        mComponentManager->OnRemove<T>(std::move(observer));
+    }
+
     template<typename T>
     bool HasComponent(Entity entity) {
         return mComponentManager->HasComponent<T>(entity);
@@ -69,10 +136,156 @@ public:
         return mComponentManager->GetComponentType<T>();
     }
 
+    // Iterate all entities that have every component in Ts..., e.g.
+    // coordinator->View<TransformComponent, RigidbodyComponent>().Each([](Entity e, auto& t, auto& rb) {...});
+    template<typename... Ts>
+    ComponentView<Ts...> View() {
+        return mComponentManager->View<Ts...>();
+    }
+
+    // Applies every change recorded in the buffer. Component arrays and signatures are
+    // updated as commands are replayed, but each touched entity's signature is only sent
+    // to the systems once at the end instead of once per component change. Commands for an
+    // entity that is no longer alive when they are replayed, e.g. recorded after its
+    // Destroy, are dropped.
+    void Flush(CommandBuffer& buffer) {
+        using CommandType = CommandBuffer::CommandType;
+
+        std::uint32_t deferredCount = 0;
+        auto commands = buffer.Take(deferredCount);
+        std::vector<Entity> created(deferredCount);
+
+        // Entities whose signature changed, with the component bits that changed for each
+        EntitySet touched;
+        std::vector<Signature> changedTypes;
+
+        for (auto& command : commands) {
+            if (command.type == CommandType::Create) {
+                created[command.entity] = mEntityManager->CreateEntity();
+                continue;
+            }
+
+            Entity entity = command.deferred ? created[command.entity] : command.entity;
+            if (!mEntityManager->IsAlive(entity)) {
+                continue;
+            }
+
+            if (command.type == CommandType::Destroy) {
+                DestroyEntity(entity);
+                if (touched.Contains(entity)) {
+                    changedTypes[touched.IndexOf(entity)].reset();
+                }
+                continue;
+            }
+
+            ComponentType type = command.op->Apply(*mComponentManager, entity);
+
+            auto signature = mEntityManager->GetSignature(entity);
+            signature.set(type, command.type == CommandType::Add);
+            mEntityManager->SetSignature(entity, signature);
+
+            if (!touched.Contains(entity)) {
+                touched.Insert(entity);
+                changedTypes.emplace_back();
+            }
+            changedTypes[touched.IndexOf(entity)].set(type);
+        }
+
+        for (std::size_t i = 0; i < touched.Size(); ++i) {
+            // Destroyed entities have no changes left to broadcast
+            if (changedTypes[i].none()) {
+                continue;
+            }
+
+            mSystemManager->EntitySignatureChanged(touched[i], mEntityManager->GetSignature(touched[i]), changedTypes[i]);
+        }
+    }
+
+    // Creates count entities with a copy of every component in the prefab. Each component
+    // column is filled for the whole batch at once and systems take the batch in one pass,
+    // which is much faster than CreateEntity and AddComponent per entity for large crowds.
+    std::vector<Entity> Instantiate(const Prefab& prefab, std::size_t count) {
+        std::vector<Entity> entities(count);
+        Signature signature = prefab.GetSignature();
+        for (Entity& entity : entities) {
+            entity = mEntityManager->CreateEntity();
+            mEntityManager->SetSignature(entity, signature);
+        }
+
+        for (auto const& column : prefab.mColumns) {
+            column->Fill(*mComponentManager, entities.data(), count);
+        }
+
+        mSystemManager->EntitiesCreated(entities.data(), count, signature);
+        return entities;
+    }
+
+    // Writes every entity and every snapshot capable component to path, see snapshot.hpp.
+    // Resources referenced by components must be registered in assets.
+    bool SaveSnapshot(const std::string& path, const AssetRegistry& assets) {
+        SnapshotWriter writer;
+        writer.Write(SNAPSHOT_MAGIC);
+        writer.Write(SNAPSHOT_VERSION);
+
+        mEntityManager->WriteSnapshot(writer);
+        if (!mComponentManager->WriteSnapshot(writer, assets)) {
+            return false;
+        }
+
+        return WriteFile(path, writer.Buffer());
+    }
+
+    // Replaces the whole world with a snapshot written by SaveSnapshot. Entity handles from
+    // the snapshot are valid again afterwards, handles created since then are not. Nothing
+    // changes if the file cannot be read or does not match the registered components.
+    bool LoadSnapshot(const std::string& path, const AssetRegistry& assets) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            return false;
+        }
+
+        SnapshotReader reader(file.Data(), file.Size());
+        std::uint32_t magic = 0;
+        std::uint32_t version = 0;
+        if (!reader.Read(magic) || !reader.Read(version) || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+            std::cerr << "Not a snapshot of this version: " << path << std::endl;
+            return false;
+        }
+
+        auto entityManager = std::make_unique<EntityManager>(mEntityManager->GetMaxEntities());
+        if (!entityManager->ReadSnapshot(reader)) {
+            std::cerr << "Snapshot entity data is invalid: " << path << std::endl;
+            return false;
+        }
+
+        Signature restoredTypes;
+        auto restoreComponents = mComponentManager->ReadSnapshot(reader, assets, *entityManager, restoredTypes);
+        if (!restoreComponents) {
+            return false;
+        }
+
+        // Everything parsed, from here on the world is replaced
+        mEntityManager = std::move(entityManager);
+        restoreComponents();
+
+        // Arrays without a column in the file, whether left out when saving or without snapshot
+        // support, came back empty, so drop their bits as well
+        mSystemManager->ClearEntities();
+        mEntityManager->EachLiving([&](Entity entity) {
+            Signature signature = mEntityManager->GetSignature(entity) & restoredTypes;
+            mEntityManager->SetSignature(entity, signature);
+            mSystemManager->EntitySignatureChanged(entity, signature);
+        });
+        return true;
+    }
+
     // System methods
     template<typename T>
     std::shared_ptr<T> RegisterSystem() {
-        return mSystemManager->RegisterSystem<T>();
+        auto system = mSystemManager->RegisterSystem<T>();
+        system->mComponentManager = mComponentManager.get();
+        system->mJobSystem = mJobSystem.get();
+        return system;
     }
 
     template<typename T>
@@ -80,7 +293,37 @@ public:
         mSystemManager->SetSignature<T>(signature);
     }
 
+    // Declares which component types a system reads and writes, see RunSystems
+    template<typename T>
+    void SetSystemAccess(Signature reads, Signature writes) {
+        mSystemManager->SetAccess<T>(reads, writes);
+    }
+
+    template<typename T>
+    void ScheduleSystem(std::function<void(float)> update) {
+        mSystemManager->ScheduleSystem<T>(std::move(update));
+    }
+
+    // Runs all scheduled systems for one frame, overlapping those with disjoint access.
+    // Each frame gets its own change tick, so a system that remembers the tick it last
+    // ran in can ask for everything changed since then.
+    void RunSystems(float deltaTime) {
+        mComponentManager->AdvanceChangeTick();
+        mSystemManager->RunSystems(deltaTime);
+    }
+
+    const std::vector<SystemTiming>& GetSystemTimings() const {
+        return mSystemManager->GetSystemTimings();
+    }
+
+    // Worker threads shared by the scheduler and by systems fanning out their own work
+    JobSystem& GetJobSystem() {
+        return *mJobSystem;
+    }
+
 private:
+    // Declared first so it outlives the systems that may still reference it
+    std::unique_ptr<JobSystem> mJobSystem;
     std::unique_ptr<ComponentManager> mComponentManager;
     std::unique_ptr<EntityManager> mEntityManager;
     std::unique_ptr<SystemManager> mSystemManager;
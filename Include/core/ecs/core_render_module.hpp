@@ -11,7 +11,11 @@
 class CoreLightingModule : public RenderModule
 {
 public:
-  std::pair<std::string, std::string> GetShaders(RenderSystem *renderSystem, Entity e) const;
+  std::pair<std::string_view, std::string_view> GetShaders(RenderSystem *renderSystem, Entity e) const;
+
+  void GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const override;
+
+  bool CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const override;
 
   void UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e) override;
 
@@ -29,7 +33,11 @@ public:
 class CoreObjectModule : public RenderModule
 {
 public:
-  std::pair<std::string, std::string> GetShaders(RenderSystem *renderSystem, Entity e) const override;
+  std::pair<std::string_view, std::string_view> GetShaders(RenderSystem *renderSystem, Entity e) const override;
+
+  void GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const override;
+
+  bool CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const override;
 
   void UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e) override;
 
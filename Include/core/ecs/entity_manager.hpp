@@ -1,53 +1,157 @@
 #pragma once
 
 #include "types.hpp"
-#include <array>
+#include "snapshot.hpp"
+#include <vector>
 #include <queue>
 #include <cassert>
 
 class EntityManager {
 public:
-    EntityManager() {
-        for (Entity entity = 0; entity < MAX_ENTITIES; ++entity) {
-            mAvailableEntities.push(entity);
-        }
+    explicit EntityManager(Entity maxEntities = DEFAULT_MAX_ENTITIES) : mMaxEntities(maxEntities) {
+        assert(maxEntities <= MAX_ENTITIES && "Entity cap exceeds the entity index range.");
     }
 
     Entity CreateEntity() {
-        assert(mLivingEntityCount < MAX_ENTITIES && "Too many entities in existence.");
+        assert(mLivingEntityCount < mMaxEntities && "Too many entities in existence.");
 
-        Entity id = mAvailableEntities.front();
-        mAvailableEntities.pop();
+        // Reuse the slot that has been free the longest, so a stale handle needs many
+        // reuses of the same slot before its generation could match again
+        Entity index;
+        if (!mFreeIndices.empty()) {
+            index = mFreeIndices.front();
+            mFreeIndices.pop();
+        }
+        else {
+            // Slots are only created when no freed one is available
+            index = static_cast<Entity>(mGenerations.size());
+            mGenerations.push_back(0);
+            mSignatures.emplace_back();
+        }
         ++mLivingEntityCount;
 
-        return id;
+        return MakeEntity(index, mGenerations[index]);
     }
 
     void DestroyEntity(Entity entity) {
-        assert(entity < MAX_ENTITIES && "Entity out of range.");
+        assert(IsAlive(entity) && "Destroying an entity that is not alive.");
 
-        mSignatures[entity].reset();
+        Entity index = EntityIndex(entity);
+        mSignatures[index].reset();
+        mGenerations[index] = (mGenerations[index] + 1) & ENTITY_GENERATION_MASK;
 
-        mAvailableEntities.push(entity);
+        mFreeIndices.push(index);
         --mLivingEntityCount;
     }
 
+    bool IsAlive(Entity entity) const {
+        Entity index = EntityIndex(entity);
+        return index < mGenerations.size() && mGenerations[index] == EntityGeneration(entity);
+    }
+
     void SetSignature(Entity entity, Signature signature) {
-        assert(entity < MAX_ENTITIES && "Entity out of range.");
+        assert(IsAlive(entity) && "Entity is not alive.");
+
+        mSignatures[EntityIndex(entity)] = signature;
+    }
+
+    Signature GetSignature(Entity entity) const {
+        assert(IsAlive(entity) && "Entity is not alive.");
 
-        mSignatures[entity] = signature;
+        return mSignatures[EntityIndex(entity)];
     }
 
-    Signature GetSignature(Entity entity) {
-        assert(entity < MAX_ENTITIES && "Entity out of range.");
+    Entity GetMaxEntities() const {
+        return mMaxEntities;
+    }
+
+    uint32_t GetLivingEntityCount() const {
+        return mLivingEntityCount;
+    }
+
+    // Calls func(entity) for every living entity, in slot order
+    template<typename Func>
+    void EachLiving(Func&& func) const {
+        std::vector<bool> free(mGenerations.size(), false);
+        for (auto queue = mFreeIndices; !queue.empty(); queue.pop()) {
+            free[queue.front()] = true;
+        }
 
-        return mSignatures[entity];
+        for (Entity index = 0; index < mGenerations.size(); ++index) {
+            if (!free[index]) {
+                func(MakeEntity(index, mGenerations[index]));
+            }
+        }
+    }
+
+    // Slot count, generations, signatures, then the free list oldest first
+    void WriteSnapshot(SnapshotWriter& writer) const {
+        writer.Write(static_cast<std::uint32_t>(mGenerations.size()));
+        writer.Write(mGenerations.data(), mGenerations.size() * sizeof(std::uint32_t));
+        for (const Signature& signature : mSignatures) {
+            writer.Write(static_cast<std::uint32_t>(signature.to_ulong()));
+        }
+
+        writer.Write(static_cast<std::uint32_t>(mFreeIndices.size()));
+        for (auto queue = mFreeIndices; !queue.empty(); queue.pop()) {
+            writer.Write(queue.front());
+        }
+    }
+
+    // Replaces all state with a snapshot, returns false and changes nothing if it is invalid
+    bool ReadSnapshot(SnapshotReader& reader) {
+        std::uint32_t slotCount = 0;
+        if (!reader.Read(slotCount) || slotCount > MAX_ENTITIES) {
+            return false;
+        }
+
+        std::vector<std::uint32_t> generations(slotCount);
+        std::vector<Signature> signatures(slotCount);
+        if (!reader.Read(generations.data(), slotCount * sizeof(std::uint32_t))) {
+            return false;
+        }
+        for (Signature& signature : signatures) {
+            std::uint32_t bits = 0;
+            if (!reader.Read(bits)) {
+                return false;
+            }
+            signature = Signature(bits);
+        }
+
+        std::uint32_t freeCount = 0;
+        if (!reader.Read(freeCount) || freeCount > slotCount || slotCount - freeCount > mMaxEntities) {
+            return false;
+        }
+
+        // Free slots are listed once and have no components, so component columns can
+        // trust a slot whose generation matches to be alive
+        std::queue<Entity> freeIndices;
+        std::vector<bool> free(slotCount, false);
+        for (std::uint32_t i = 0; i < freeCount; ++i) {
+            Entity index = 0;
+            if (!reader.Read(index) || index >= slotCount || free[index] || signatures[index].any()) {
+                return false;
+            }
+            free[index] = true;
+            freeIndices.push(index);
+        }
+
+        mGenerations = std::move(generations);
+        mSignatures = std::move(signatures);
+        mFreeIndices = std::move(freeIndices);
+        mLivingEntityCount = slotCount - freeCount;
+        return true;
     }
 
 private:
-    std::queue<Entity> mAvailableEntities{};
+    // Slots freed by DestroyEntity, oldest first
+    std::queue<Entity> mFreeIndices{};
+
+    // Current generation and signature of every slot handed out so far
+    std::vector<std::uint32_t> mGenerations{};
+    std::vector<Signature> mSignatures{};
 
-    std::array<Signature, MAX_ENTITIES> mSignatures{};
+    Entity mMaxEntities{};
 
     uint32_t mLivingEntityCount{};
-};
\ No newline at end of file
+};
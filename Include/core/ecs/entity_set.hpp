@@ -0,0 +1,195 @@
+#pragma once
+
+#include "types.hpp"
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <cassert>
+
+// Number of entries in each page of the sparse entity -> index lookup.
+// Pages are only allocated once an entity in their range is inserted.
+const std::size_t SPARSE_PAGE_SIZE = 4096;
+
+// Set of entities stored as a packed array plus a paged sparse index.
+// Insert, Erase and Contains are O(1) and iteration is a linear walk over the packed array.
+// The sparse index is keyed by entity slot and the packed array keeps the full handle,
+// so a stale handle to a reused slot is never reported as contained.
+// Erase moves the last entity into the freed spot, so iteration order is not stable
+// unless sorted iteration is turned on.
+class EntitySet
+{
+public:
+    bool Contains(Entity entity) const
+    {
+        std::size_t page = EntityIndex(entity) / SPARSE_PAGE_SIZE;
+        if (page >= mSparse.size() || !mSparse[page])
+            return false;
+
+        // A stale slot may point anywhere in the packed range, so confirm the entity owns it
+        Entity index = mSparse[page][EntityIndex(entity) % SPARSE_PAGE_SIZE];
+        return index < mDense.size() && mDense[index] == entity;
+    }
+
+    // Packed index of an entity that is in the set
+    std::size_t IndexOf(Entity entity) const
+    {
+        assert(Contains(entity) && "Entity is not in the set.");
+
+        return mSparse[EntityIndex(entity) / SPARSE_PAGE_SIZE][EntityIndex(entity) % SPARSE_PAGE_SIZE];
+    }
+
+    // Appends an entity that is not in the set yet and returns its packed index
+    std::size_t Insert(Entity entity)
+    {
+        assert(!Contains(entity) && "Entity inserted into set more than once.");
+
+        if (!mDense.empty() && EntityIndex(entity) < EntityIndex(mDense.back()))
+            mUnsorted = true;
+
+        std::size_t index = mDense.size();
+        SparseSlot(entity) = static_cast<Entity>(index);
+        mDense.push_back(entity);
+        ++mRevision;
+        return index;
+    }
+
+    // Removes an entity that is in the set by moving the last entity into its spot
+    void Erase(Entity entity)
+    {
+        std::size_t index = IndexOf(entity);
+        Entity last = mDense.back();
+
+        if (index + 1 < mDense.size())
+            mUnsorted = true;
+
+        mDense[index] = last;
+        mSparse[EntityIndex(last) / SPARSE_PAGE_SIZE][EntityIndex(last) % SPARSE_PAGE_SIZE] = static_cast<Entity>(index);
+        mDense.pop_back();
+        ++mRevision;
+    }
+
+    // Makes room for size entities so a batch of inserts does not regrow the packed array.
+    // Grows at least geometrically, so reserving for many small batches stays amortized O(1).
+    void Reserve(std::size_t size)
+    {
+        if (size > mDense.capacity())
+            mDense.reserve(std::max(size, mDense.capacity() * 2));
+    }
+
+    void Clear()
+    {
+        mDense.clear();
+        mUnsorted = false;
+        ++mRevision;
+    }
+
+    // Changes whenever an entity is inserted or erased, so a cache built from the
+    // set's contents can tell when it is stale without comparing them
+    std::uint32_t Revision() const { return mRevision; }
+
+    std::size_t Size() const { return mDense.size(); }
+    bool Empty() const { return mDense.empty(); }
+
+    const Entity *Data() const { return mDense.data(); }
+    Entity operator[](std::size_t index) const { return mDense[index]; }
+
+    // When enabled, iteration visits entities in ascending slot order. The packed array is
+    // re-sorted lazily on the first iteration after a change, so systems that need a
+    // deterministic order only pay for it once per batch of changes.
+    void SetSortedIteration(bool sorted)
+    {
+        mSortedIteration = sorted;
+    }
+
+    std::vector<Entity>::const_iterator begin() const
+    {
+        if (mSortedIteration && mUnsorted)
+            Sort();
+        return mDense.begin();
+    }
+
+    std::vector<Entity>::const_iterator end() const
+    {
+        return mDense.end();
+    }
+
+private:
+    Entity &SparseSlot(Entity entity)
+    {
+        std::size_t page = EntityIndex(entity) / SPARSE_PAGE_SIZE;
+        if (page >= mSparse.size())
+            mSparse.resize(page + 1);
+        if (!mSparse[page])
+            mSparse[page] = std::make_unique<Entity[]>(SPARSE_PAGE_SIZE);
+        return mSparse[page][EntityIndex(entity) % SPARSE_PAGE_SIZE];
+    }
+
+    void Sort() const
+    {
+        std::sort(mDense.begin(), mDense.end(), [](Entity a, Entity b)
+                  { return EntityIndex(a) < EntityIndex(b); });
+        for (std::size_t i = 0; i < mDense.size(); ++i)
+        {
+            Entity index = EntityIndex(mDense[i]);
+            mSparse[index / SPARSE_PAGE_SIZE][index % SPARSE_PAGE_SIZE] = static_cast<Entity>(i);
+        }
+        mUnsorted = false;
+    }
+
+    // Mutable so sorted iteration can reorder lazily from const access
+    mutable std::vector<Entity> mDense;
+    mutable std::vector<std::unique_ptr<Entity[]>> mSparse;
+    mutable bool mUnsorted = false;
+
+    bool mSortedIteration = false;
+
+    std::uint32_t mRevision = 0;
+};
+
+// Set of at most one entity with the parts of EntitySet's interface component storage
+// uses, for singleton components that should not page in a sparse index
+class SingleEntitySet
+{
+public:
+    bool Contains(Entity entity) const { return mSize == 1 && mEntity == entity; }
+
+    std::size_t IndexOf(Entity entity) const
+    {
+        assert(Contains(entity) && "Entity is not in the set.");
+
+        return 0;
+    }
+
+    std::size_t Insert(Entity entity)
+    {
+        assert(mSize == 0 && "Singleton component added to a second entity.");
+
+        mEntity = entity;
+        mSize = 1;
+        return 0;
+    }
+
+    void Erase(Entity entity)
+    {
+        assert(Contains(entity) && "Entity is not in the set.");
+
+        mSize = 0;
+    }
+
+    void Reserve(std::size_t size)
+    {
+        assert(size <= 1 && "Singleton component added to a second entity.");
+    }
+
+    void Clear() { mSize = 0; }
+
+    std::size_t Size() const { return mSize; }
+    bool Empty() const { return mSize == 0; }
+
+    const Entity *Data() const { return &mEntity; }
+    Entity operator[](std::size_t) const { return mEntity; }
+
+private:
+    Entity mEntity = NULL_ENTITY;
+    std::size_t mSize = 0;
+};
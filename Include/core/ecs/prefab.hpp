@@ -0,0 +1,84 @@
+#pragma once
+
+#include "component_manager.hpp"
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Template for spawning many identical entities. A prefab holds one value per component
+// type, Coordinator::Instantiate creates a batch of entities and fills each component
+// column for the whole batch at once, e.g.
+//   Prefab debris;
+//   debris.Add(TransformComponent{}).Add(WorldMatrixComponent{}).Add(ModelComponent{rockModel});
+//   std::vector<Entity> rocks = coordinator->Instantiate(debris, 5000);
+// Copying a prefab is cheap, the component values are shared until replaced with Set.
+class Prefab
+{
+public:
+    template <typename T>
+    Prefab &Add(T component)
+    {
+        assert(ComponentFamily::Id<T>() < MAX_COMPONENTS && "Too many component types.");
+        assert(!Has<T>() && "Component added to prefab more than once.");
+
+        mSignature.set(ComponentFamily::Id<T>());
+        mColumns.push_back(std::make_shared<Column<T>>(std::move(component)));
+        return *this;
+    }
+
+    // Replaces the value of a component the prefab already has, or adds it
+    template <typename T>
+    Prefab &Set(T component)
+    {
+        if (!Has<T>())
+            return Add(std::move(component));
+
+        for (auto &column : mColumns)
+        {
+            if (column->Type() == ComponentFamily::Id<T>())
+                column = std::make_shared<Column<T>>(std::move(component));
+        }
+        return *this;
+    }
+
+    template <typename T>
+    bool Has() const
+    {
+        return mSignature.test(ComponentFamily::Id<T>());
+    }
+
+    Signature GetSignature() const { return mSignature; }
+
+private:
+    friend class Coordinator;
+
+    // Type erased component value that copies itself into a batch of entities
+    class IColumn
+    {
+    public:
+        virtual ~IColumn() = default;
+        virtual std::uint32_t Type() const = 0;
+        virtual void Fill(ComponentManager &componentManager, const Entity *entities, std::size_t count) const = 0;
+    };
+
+    template <typename T>
+    class Column : public IColumn
+    {
+    public:
+        explicit Column(T component) : mComponent(std::move(component)) {}
+
+        std::uint32_t Type() const override { return ComponentFamily::Id<T>(); }
+
+        void Fill(ComponentManager &componentManager, const Entity *entities, std::size_t count) const override
+        {
+            componentManager.AddComponents<T>(entities, count, mComponent);
+        }
+
+    private:
+        T mComponent;
+    };
+
+    std::vector<std::shared_ptr<const IColumn>> mColumns;
+    Signature mSignature;
+};
@@ -4,11 +4,53 @@
 #include "types.hpp"
 #include "components.hpp"
 #include "../camera.hpp"
+#include "../frame_allocator.hpp"
+#include "../light_clusters.hpp"
+#include "../render_queue.hpp"
+#include "../uniforms.hpp"
+#include <array>
 #include <memory>
 #include <utility>
+#include <string_view>
 #include <glad.h>
 #include <functional>
 class RenderSystem;
+class Mesh;
+
+// Uniform block binding points, every program linked by GetOrCreateShader has its
+// FrameData and LightData blocks bound to these
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+const unsigned int LIGHT_UNIFORM_BINDING = 1;
+
+// std140 layout of the FrameData block, uploaded once per scene pass
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 clipPlane;
+    glm::vec3 viewPos;
+    float time;
+    int enableClip;
+    int padding[3];
+};
+static_assert(sizeof(FrameUniforms) == 176, "FrameUniforms must match the std140 FrameData block");
+
+// std140 layout of the LightData block, uploaded once per scene pass. The lights themselves
+// and the per cluster light lists live in texture buffers.
+struct LightUniforms
+{
+    // Tiles x, tiles y, depth slices, light count
+    std::uint32_t clusterGrid[4];
+
+    // LightClusters::FIRST_SLICE_DEPTH and slice scale
+    glm::vec4 clusterDepth;
+};
+static_assert(sizeof(LightUniforms) == 32, "LightUniforms must match the std140 LightData block");
+
+// Texture units of the clustered lighting buffers, above those materials bind
+const unsigned int LIGHT_TEXEL_UNIT = 13;
+const unsigned int CLUSTER_RANGE_UNIT = 14;
+const unsigned int CLUSTER_LIGHT_UNIT = 15;
 
 struct OffscreenObjects
 {
@@ -37,7 +79,17 @@ public:
             glDeleteFramebuffers(1, &fb);
     };
 
-    virtual std::pair<std::string, std::string> GetShaders(RenderSystem *renderSystem, Entity e) const = 0;
+    // Paths must outlive the frame, string literals in practice
+    virtual std::pair<std::string_view, std::string_view> GetShaders(RenderSystem *renderSystem, Entity e) const = 0;
+
+    // Fills in what the module knows about how the entity is drawn, so the render queue can
+    // group draws that share state. Leaves the hints alone for entities it does not handle.
+    virtual void GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const {}
+
+    // Whether other can join an instanced draw of first: every uniform the module uploads
+    // for other must match first's, apart from the model matrix each instance carries.
+    // Modules that upload per object state, e.g. a bone palette, refuse their entities.
+    virtual bool CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const { return true; }
 
     // once an object
     virtual void UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity entity) {}
@@ -64,9 +116,13 @@ struct ShaderKey
 {
     std::string vertex;
     std::string fragment;
+
+    // Vertex shader compiled with INSTANCED defined, taking the model matrix per instance
+    bool instanced = false;
+
     bool operator==(const ShaderKey &other) const
     {
-        return vertex == other.vertex && fragment == other.fragment;
+        return vertex == other.vertex && fragment == other.fragment && instanced == other.instanced;
     }
 };
 
@@ -74,11 +130,11 @@ struct ShaderKeyHash
 {
     std::size_t operator()(const ShaderKey &k) const noexcept
     {
-        return std::hash<std::string>()(k.vertex) ^ (std::hash<std::string>()(k.fragment) << 1);
+        return std::hash<std::string>()(k.vertex) ^ (std::hash<std::string>()(k.fragment) << 1) ^ k.instanced;
     }
 };
 
-class RenderSystem : public System
+class RenderSystem : public System<const TransformComponent>
 {
 public:
     std::unordered_map<ShaderKey, unsigned int, ShaderKeyHash> shaderCache;
@@ -91,15 +147,101 @@ public:
     unsigned int sceneFBO, sceneColorTex, sceneDepthRBO;
     unsigned int pingpongFBO[2], pingpongColorTex[2];
     unsigned int quadVAO, quadVBO;
+    unsigned int frameUBO, lightUBO;
+
+    // Model matrices of every instanced draw in the scene being rendered
+    unsigned int instanceVBO;
+
+    // Texture buffers of the clustered lights: three texels per light, the (first, count)
+    // range of each cluster, and the light indices the ranges point into
+    unsigned int lightTexelBuffer, lightTexelTex;
+    unsigned int clusterRangeBuffer, clusterRangeTex;
+    unsigned int clusterLightBuffer, clusterLightTex;
+
+    // Entities with a PointLightComponent, kept current by component observers so
+    // lighting modules do not rescan every entity for lights
+    EntitySet pointLights;
+
+    // Heap allocations made during the last complete frame, see GetHeapAllocationCount()
+    std::uint64_t frameHeapAllocations = 0;
+
+    unsigned int GetOrCreateShader(std::string_view vert, std::string_view frag, bool instanced = false);
 
-    unsigned int GetOrCreateShader(const std::string &vert, const std::string &frag);
+    // Uniform locations of a program, reflected when GetOrCreateShader linked it
+    const ProgramUniforms &GetUniforms(unsigned int program);
+
+    // Binds a 2D texture to a unit unless RenderScene already bound it there, modules bind
+    // through this so sorted draws sharing a texture do not rebind it
+    void BindTexture(unsigned int slot, unsigned int texture);
+
+    // Draws a mesh once per entity of the batch RenderScene is drawing, modules draw
+    // static meshes through this so entities sharing them can be instanced
+    void DrawMesh(const Mesh &mesh);
 
     void AddModule(std::unique_ptr<RenderModule> module);
     void Init(std::shared_ptr<Coordinator> coordinator, int screenWidth, int screenHeight);
     void InitPostProcessing();
+    void InitUniformBuffers();
     void Update(float deltaTime, const Camera &camera);
     void RenderScene(float deltaTime, const Camera &camera, bool mainRender = true, bool useClippingPlane = false, glm::vec4 clippingPlane = glm::vec4(-1));
 
+    // World matrix kept by the TransformSystem, or the local transform for entities
+    // without a WorldMatrixComponent
+    glm::mat4 GetModelMatrix(Entity entity) const;
+
     // returns image that results from pass, passIndex is the number of passes that have already happened in the frame
     unsigned int DoPostProcessPass(std::unique_ptr<PostProcessPass> &pass, unsigned int inputTex, int &passIndex);
+
+private:
+    // Reused for cache lookups so a hit does not allocate once its strings have grown
+    ShaderKey mShaderLookup;
+
+    // Fills the FrameData and LightData blocks for one pass of RenderScene
+    void UploadPassUniforms(const Camera &camera, bool useClippingPlane, glm::vec4 clippingPlane);
+
+    // Whether every module lets the draw of other join an instanced draw of first
+    bool CanInstance(const DrawItem &first, const DrawItem &other, bool mainRender);
+
+    // Program compiled from the same sources with the instanced vertex shader
+    unsigned int GetInstancedProgram(unsigned int program);
+
+    // Light assignment of the pass being rendered, its buffers are reused between passes
+    LightClusters mLightClusters;
+    std::vector<ClusterLight> mClusterLights;
+    std::vector<glm::vec4> mLightTexels;
+    std::vector<std::uint32_t> mClusterRanges;
+    GLint mMaxTextureBufferSize = 0;
+
+    std::unordered_map<unsigned int, ProgramUniforms> mProgramUniforms;
+
+    // Modules ask for the same program many times in a row while a sorted scene draws
+    unsigned int mLastUniformsProgram = 0;
+    const ProgramUniforms *mLastUniforms = nullptr;
+
+    // Draws of the scene being rendered, reused between renders
+    RenderQueue mRenderQueue;
+
+    // Sources of each program GetOrCreateShader linked and their instanced variants
+    std::unordered_map<unsigned int, ShaderKey> mProgramKeys;
+    std::unordered_map<unsigned int, unsigned int> mInstancedPrograms;
+
+    // Runs of queued draws submitted as one draw, a run of one is drawn without instancing
+    struct DrawBatch
+    {
+        std::uint32_t first;
+        std::uint32_t count;
+        std::uint32_t firstInstance;
+    };
+    std::vector<DrawBatch> mBatches;
+    std::vector<glm::mat4> mInstanceMatrices;
+
+    // Instances DrawMesh draws and where their matrices start in instanceVBO
+    GLsizei mInstanceCount = 1;
+    std::size_t mInstanceOffset = 0;
+
+    // Texture bound to each of the first units during RenderScene, UNKNOWN_TEXTURE outside it
+    static constexpr unsigned int UNKNOWN_TEXTURE = ~0u;
+    std::array<unsigned int, 16> mBoundTextures;
+
+    std::uint64_t mFrameStartAllocations = 0;
 };
\ No newline at end of file
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Binary world snapshots, see Coordinator::SaveSnapshot / LoadSnapshot.
+//
+// Trivially copyable components are stored as raw columns and restored with one
+// memcpy per storage page. Components holding resources specialize SnapshotTraits
+// and store those resources as names looked up in an AssetRegistry. Component types
+// with neither are left out of snapshots and come back empty after a load.
+//
+// A snapshot is tied to the build that wrote it: columns are matched by component
+// type and checked against the type's name and size, nothing is converted.
+
+// "VXSN", then the format version, at the start of every snapshot file
+const std::uint32_t SNAPSHOT_MAGIC = 0x4E535856;
+const std::uint32_t SNAPSHOT_VERSION = 1;
+
+// Appends snapshot data to a growing byte buffer
+class SnapshotWriter
+{
+public:
+    void Write(const void *data, std::size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+    }
+
+    template <typename T>
+    void Write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written raw.");
+        Write(&value, sizeof(T));
+    }
+
+    void WriteString(const std::string &value)
+    {
+        Write(static_cast<std::uint32_t>(value.size()));
+        Write(value.data(), value.size());
+    }
+
+    std::size_t Size() const { return mBuffer.size(); }
+
+    const std::vector<char> &Buffer() const { return mBuffer; }
+
+private:
+    std::vector<char> mBuffer;
+};
+
+// Reads snapshot data from a byte range. Every read is bounds checked, a read past
+// the end returns false instead of touching memory outside the range.
+class SnapshotReader
+{
+public:
+    SnapshotReader(const char *data, std::size_t size) : mData(data), mSize(size) {}
+
+    bool Read(void *out, std::size_t size)
+    {
+        const char *bytes = Take(size);
+        if (!bytes)
+            return false;
+
+        std::memcpy(out, bytes, size);
+        return true;
+    }
+
+    template <typename T>
+    bool Read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read raw.");
+        return Read(&value, sizeof(T));
+    }
+
+    bool ReadString(std::string &value)
+    {
+        std::uint32_t size = 0;
+        if (!Read(size))
+            return false;
+
+        const char *bytes = Take(size);
+        if (!bytes)
+            return false;
+
+        value.assign(bytes, size);
+        return true;
+    }
+
+    // Returns a pointer to the next size bytes and moves past them, or nullptr if there
+    // are not that many left. The bytes are not aligned for any type, copy them out.
+    const char *Take(std::size_t size)
+    {
+        if (size > mSize - mOffset)
+            return nullptr;
+
+        const char *bytes = mData + mOffset;
+        mOffset += size;
+        return bytes;
+    }
+
+    std::size_t Remaining() const { return mSize - mOffset; }
+
+private:
+    const char *mData;
+    std::size_t mSize;
+    std::size_t mOffset = 0;
+};
+
+using AssetFamily = TypeFamily<struct AssetFamilyTag>;
+
+// Names shared resources (models, materials, meshes...) so components referencing them
+// can be written to a snapshot. The same names must be registered before loading.
+class AssetRegistry
+{
+public:
+    template <typename T>
+    void Register(const std::string &name, std::shared_ptr<T> asset)
+    {
+        mNames[asset.get()] = name;
+        mAssets[name] = {std::move(asset), AssetFamily::Id<T>()};
+    }
+
+    // Empty if the asset was never registered
+    std::string NameOf(const void *asset) const
+    {
+        auto it = mNames.find(asset);
+        return it == mNames.end() ? std::string() : it->second;
+    }
+
+    // nullptr if nothing of type T is registered under name
+    template <typename T>
+    std::shared_ptr<T> Find(const std::string &name) const
+    {
+        auto it = mAssets.find(name);
+        if (it == mAssets.end() || it->second.type != AssetFamily::Id<T>())
+            return nullptr;
+
+        return std::static_pointer_cast<T>(it->second.asset);
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<void> asset;
+        std::uint32_t type;
+    };
+
+    std::unordered_map<std::string, Entry> mAssets;
+    std::unordered_map<const void *, std::string> mNames;
+};
+
+// Specialize for components that are not trivially copyable:
+//   static bool Write(SnapshotWriter &, const AssetRegistry &, const T &);
+//   static bool Read(SnapshotReader &, const AssetRegistry &, T &);
+// Write fails when a resource has no registered name, Read when the data is
+// truncated or a name is not registered.
+template <typename T>
+struct SnapshotTraits
+{
+};
+
+template <typename T, typename = void>
+struct HasSnapshotTraits : std::false_type
+{
+};
+
+template <typename T>
+struct HasSnapshotTraits<T, std::void_t<decltype(&SnapshotTraits<T>::Write), decltype(&SnapshotTraits<T>::Read)>> : std::true_type
+{
+};
+
+// Null pointers are written as an empty name
+template <typename T>
+bool WriteAssetRef(SnapshotWriter &writer, const AssetRegistry &assets, const std::shared_ptr<T> &asset)
+{
+    std::string name = asset ? assets.NameOf(asset.get()) : std::string();
+    if (asset && name.empty())
+        return false;
+
+    writer.WriteString(name);
+    return true;
+}
+
+template <typename T>
+bool ReadAssetRef(SnapshotReader &reader, const AssetRegistry &assets, std::shared_ptr<T> &asset)
+{
+    std::string name;
+    if (!reader.ReadString(name))
+        return false;
+
+    asset = name.empty() ? nullptr : assets.Find<T>(name);
+    return name.empty() || asset;
+}
+
+template <typename T>
+bool WriteAssetRefs(SnapshotWriter &writer, const AssetRegistry &assets, const std::vector<std::shared_ptr<T>> &list)
+{
+    writer.Write(static_cast<std::uint32_t>(list.size()));
+    for (const auto &asset : list)
+    {
+        if (!WriteAssetRef(writer, assets, asset))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool ReadAssetRefs(SnapshotReader &reader, const AssetRegistry &assets, std::vector<std::shared_ptr<T>> &list)
+{
+    std::uint32_t count = 0;
+    if (!reader.Read(count))
+        return false;
+
+    list.clear();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::shared_ptr<T> asset;
+        if (!ReadAssetRef(reader, assets, asset))
+            return false;
+        list.push_back(std::move(asset));
+    }
+    return true;
+}
+
+// Read-only view of a whole file. Memory mapped where the platform supports it,
+// read into memory otherwise.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &path);
+
+    const char *Data() const { return mData; }
+    std::size_t Size() const { return mSize; }
+
+private:
+    const char *mData = nullptr;
+    std::size_t mSize = 0;
+
+    bool mMapped = false;
+    std::vector<char> mFallback;
+};
+
+// Writes the whole buffer to path, replacing the file
+bool WriteFile(const std::string &path, const std::vector<char> &buffer);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "coordinator.hpp"
+#include "types.hpp"
+#include "components.hpp"
+#include "../aabb_tree.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Keeps the world bounds of every entity with a transform in an AABB tree, so questions
+// like "what is near this point" or "what is in view" do not scan every entity.
+//
+// Local bounds come from a BoundsComponent, else the ModelComponent's model, else the
+// entity is a point at its origin. They are placed with the WorldMatrixComponent when
+// present, else the local transform. Only entities whose transform, world matrix or
+// bounds changed since the last update are refit, and a refit only restructures the
+// tree when the entity left the margin around where it was inserted.
+//
+// TransformComponent, WorldMatrixComponent, ModelComponent and BoundsComponent must be
+// registered before Init. Queries must not overlap Update.
+class SpatialIndexSystem : public System<const TransformComponent>
+{
+public:
+    std::shared_ptr<Coordinator> gCoordinator;
+
+    void Init(std::shared_ptr<Coordinator> coordinator, float margin = 0.1f);
+    void Update();
+
+    // func(entity, worldBounds) for every entity whose bounds overlap box
+    template <typename Func>
+    void QueryBox(const AABB &box, Func &&func) const { mTree.QueryBox(box, func); }
+
+    // func(entity, worldBounds) for every entity whose bounds are within radius of center
+    template <typename Func>
+    void QuerySphere(const glm::vec3 &center, float radius, Func &&func) const { mTree.QuerySphere(center, radius, func); }
+
+    // func(entity, worldBounds) for every entity whose bounds intersect the frustum
+    template <typename Func>
+    void QueryFrustum(const Frustum &frustum, Func &&func) const { mTree.QueryFrustum(frustum, func); }
+
+    // The k entities with bounds closest to point, nearest first. Reusing scratch and out
+    // between queries keeps them from allocating.
+    void QueryNearest(const glm::vec3 &point, std::size_t k, std::vector<Entity> &out, AABBTree::NearestScratch &scratch) const
+    {
+        mTree.QueryNearest(point, k, out, scratch);
+    }
+
+    const AABBTree &GetTree() const { return mTree; }
+
+private:
+    // Marks an entity queued for insertion at the end of the current update
+    static constexpr std::int32_t PENDING_PROXY = -2;
+
+    AABB ComputeWorldBounds(Entity entity) const;
+
+    // Moves the entity's proxy to its current world bounds, or queues it for insertion
+    void Refit(Entity entity);
+    void RemoveProxy(Entity entity);
+
+    AABBTree mTree;
+
+    // Proxy of each entity by entity index, NULL_NODE when not indexed
+    std::vector<std::int32_t> mProxies;
+
+    // Entities new to the index this update and their world bounds
+    std::vector<AABB> mPendingBounds;
+    std::vector<Entity> mPendingEntities;
+
+    // Entities whose bounds changed in a way that leaves no change tick, e.g. a removed model
+    std::vector<Entity> mDirty;
+
+    ChangeTick mLastTick = 0;
+};
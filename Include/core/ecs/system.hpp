@@ -1,66 +1,340 @@
 #pragma once
 
 #include "types.hpp"
-#include <set>
-#include <unordered_map>
+#include "entity_set.hpp"
+#include "component_manager.hpp"
+#include "../job_system.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
 #include <memory>
 #include <cassert>
 
-class System {
+// Untyped base every system derives from through System<Ts...>
+class ISystem {
 public:
-    std::set<Entity> mEntities;
+    virtual ~ISystem() = default;
+
+    // Entities matching mSignature, packed for linear iteration.
+    // Call mEntities.SetSortedIteration(true) if the system needs a deterministic order.
+    EntitySet mEntities;
     Signature mSignature;
+
+    // Component types the system reads and writes when it runs. SystemManager::RunSystems
+    // only runs systems at the same time when neither writes what the other touches.
+    Signature mReads;
+    Signature mWrites;
+
+    // Set for systems that use the GL context, they always run on the calling thread
+    bool mMainThreadOnly = false;
+
+protected:
+    friend class Coordinator;
+
+    // Set by Coordinator::RegisterSystem
+    ComponentManager* mComponentManager = nullptr;
+    JobSystem* mJobSystem = nullptr;
 };
 
+// System over the entities that have every component in Ts... The signature and access
+// are derived from Ts at compile time: const components are read, the rest are written.
+// Both may still be widened with SetSystemSignature and SetSystemAccess, e.g. for
+// components a system only looks up for some of its entities.
+//   class GravitySystem : public System<const MassComponent, VelocityComponent> {...};
+template<typename... Ts>
+class System : public ISystem {
+public:
+    System() {
+        mSignature = ComponentSignature();
+        (SetAccess<Ts>(), ...);
+    }
+
+    static Signature ComponentSignature() {
+        Signature signature;
+        (signature.set(ComponentFamily::Id<std::remove_const_t<Ts>>()), ...);
+        return signature;
+    }
+
+    // View over Ts..., resolving each component array once per call rather than per entity
+    ComponentView<std::remove_const_t<Ts>...> View() {
+        static_assert(sizeof...(Ts) > 0, "System has no components to view.");
+        assert(mComponentManager && "System used before registered.");
+
+        return mComponentManager->View<std::remove_const_t<Ts>...>();
+    }
+
+    // Calls func(entity, Ts&...) for every entity with all of Ts..., see ComponentView::Each
+    template<typename Func>
+    void ForEach(Func&& func) {
+        View().Each(std::forward<Func>(func));
+    }
+
+    // Same as ForEach, split into jobs of grainSize entities, see ComponentView::ParallelEach
+    template<typename Func>
+    void ParallelForEach(std::size_t grainSize, Func&& func) {
+        View().ParallelEach(*mJobSystem, grainSize, std::forward<Func>(func));
+    }
+
+private:
+    template<typename T>
+    void SetAccess() {
+        std::uint32_t type = ComponentFamily::Id<std::remove_const_t<T>>();
+        if (std::is_const_v<T>) {
+            mReads.set(type);
+        }
+        else {
+            mWrites.set(type);
+        }
+    }
+};
+
+struct SystemTiming {
+    const char* name;
+    // Milliseconds from the start of RunSystems
+    double startMs;
+    double durationMs;
+    bool ranOnMainThread;
+};
+
+using SystemFamily = TypeFamily<struct SystemFamilyTag>;
+
 class SystemManager {
 public:
+    explicit SystemManager(JobSystem& jobSystem) : mJobSystem(jobSystem) {}
+
     template<typename T>
     std::shared_ptr<T> RegisterSystem() {
-        const char* typeName = typeid(T).name();
+        std::uint32_t type = SystemFamily::Id<T>();
+        if (type >= mSystems.size()) {
+            mSystems.resize(type + 1);
+        }
 
-        assert(mSystems.find(typeName) == mSystems.end() && "Registering system more than once.");
+        assert(!mSystems[type] && "Registering system more than once.");
 
         auto system = std::make_shared<T>();
-        mSystems.insert({typeName, system});
+        mSystems[type] = system;
         return system;
     }
 
     template<typename T>
     void SetSignature(Signature signature) {
-        const char* typeName = typeid(T).name();
+        std::uint32_t type = SystemFamily::Id<T>();
 
-        assert(mSystems.find(typeName) != mSystems.end() && "System used before registered.");
+        assert(type < mSystems.size() && mSystems[type] && "System used before registered.");
 
         // Set the signature for this system
-        mSystems[typeName]->mEntities.clear();
-        mSystems[typeName]->mSignature = signature;
+        mSystems[type]->mEntities.Clear();
+        mSystems[type]->mSignature = signature;
+    }
+
+    // Drops every entity from every system, membership is then rebuilt from signatures
+    void ClearEntities() {
+        for (auto const& system : mSystems) {
+            if (system) {
+                system->mEntities.Clear();
+            }
+        }
     }
 
     void EntityDestroyed(Entity entity) {
-        for (auto const& pair : mSystems) {
-            auto const& system = pair.second;
+        for (auto const& system : mSystems) {
+            if (!system || !system->mEntities.Contains(entity)) {
+                continue;
+            }
 
-            system->mEntities.erase(entity);
+            system->mEntities.Erase(entity);
         }
     }
 
-    void EntitySignatureChanged(Entity entity, Signature entitySignature) {
-        for (auto const& pair : mSystems) {
-            auto const& type = pair.first;
-            auto const& system = pair.second;
+    // changedTypes holds the component bits that were added or removed. Systems whose
+    // signature does not use any of them cannot change membership and are skipped.
+    void EntitySignatureChanged(Entity entity, Signature entitySignature, Signature changedTypes = Signature().set()) {
+        for (auto const& system : mSystems) {
+            if (!system) {
+                continue;
+            }
+
             auto const& systemSignature = system->mSignature;
+            if (systemSignature.any() && (systemSignature & changedTypes).none()) {
+                continue;
+            }
 
-            if ((entitySignature & systemSignature) == systemSignature) {
-                system->mEntities.insert(entity);
+            bool matches = (entitySignature & systemSignature) == systemSignature;
+            bool contains = system->mEntities.Contains(entity);
+
+            if (matches && !contains) {
+                system->mEntities.Insert(entity);
             }
-            else {
-                system->mEntities.erase(entity);
+            else if (!matches && contains) {
+                system->mEntities.Erase(entity);
             }
         }
     }
 
+    // Adds a batch of new entities that share one signature to the matching systems,
+    // deciding membership once per system instead of once per entity
+    void EntitiesCreated(const Entity* entities, std::size_t count, Signature signature) {
+        for (auto const& system : mSystems) {
+            if (!system) {
+                continue;
+            }
+
+            auto const& systemSignature = system->mSignature;
+            if ((signature & systemSignature) != systemSignature) {
+                continue;
+            }
+
+            system->mEntities.Reserve(system->mEntities.Size() + count);
+            for (std::size_t i = 0; i < count; ++i) {
+                system->mEntities.Insert(entities[i]);
+            }
+        }
+    }
+
+    template<typename T>
+    void SetAccess(Signature reads, Signature writes) {
+        std::uint32_t type = SystemFamily::Id<T>();
+
+        assert(type < mSystems.size() && mSystems[type] && "System used before registered.");
+
+        mSystems[type]->mReads = reads;
+        mSystems[type]->mWrites = writes;
+    }
+
+    // Adds a registered system to the frame schedule. Systems run in the order they were
+    // scheduled, except that systems with non-conflicting access may overlap.
+    template<typename T>
+    void ScheduleSystem(std::function<void(float)> update) {
+        std::uint32_t type = SystemFamily::Id<T>();
+
+        assert(type < mSystems.size() && mSystems[type] && "System used before registered.");
+
+        mSchedule.push_back({mSystems[type], std::move(update), typeid(T).name()});
+        mTimings.resize(mSchedule.size());
+    }
+
+    // Runs every scheduled system once. A system waits for all earlier scheduled systems
+    // whose access conflicts with its own, the rest run concurrently as jobs.
+    // Structural changes made while systems overlap must go through a CommandBuffer.
+    void RunSystems(float deltaTime) {
+        const std::size_t count = mSchedule.size();
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // Dependency graph, rebuilt each frame so access changes take effect immediately
+        std::vector<std::size_t> remaining(count, 0);
+        std::vector<std::vector<std::size_t>> dependents(count);
+        for (std::size_t later = 0; later < count; ++later) {
+            for (std::size_t earlier = 0; earlier < later; ++earlier) {
+                if (Conflicts(*mSchedule[earlier].system, *mSchedule[later].system)) {
+                    dependents[earlier].push_back(later);
+                    ++remaining[later];
+                }
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::vector<std::size_t> mainThreadReady;
+        std::size_t completed = 0;
+
+        auto run = [&](std::size_t index, bool onMainThread) {
+            auto start = std::chrono::steady_clock::now();
+            mSchedule[index].update(deltaTime);
+            auto end = std::chrono::steady_clock::now();
+
+            mTimings[index] = {
+                mSchedule[index].name,
+                std::chrono::duration<double, std::milli>(start - frameStart).count(),
+                std::chrono::duration<double, std::milli>(end - start).count(),
+                onMainThread};
+        };
+
+        // Both called with mutex held
+        std::function<void(std::size_t)> launch;
+        auto complete = [&](std::size_t index) {
+            ++completed;
+            for (std::size_t dependent : dependents[index]) {
+                if (--remaining[dependent] == 0) {
+                    launch(dependent);
+                }
+            }
+            finished.notify_all();
+        };
+
+        launch = [&](std::size_t index) {
+            if (mSchedule[index].system->mMainThreadOnly) {
+                mainThreadReady.push_back(index);
+                return;
+            }
+
+            mJobSystem.Submit([&, index]() {
+                run(index, false);
+                std::lock_guard<std::mutex> lock(mutex);
+                complete(index);
+            });
+        };
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (remaining[i] == 0) {
+                launch(i);
+            }
+        }
+
+        // The calling thread runs main-thread systems as they become ready and otherwise
+        // helps with queued jobs, only sleeping when there is nothing it can run
+        while (completed < count) {
+            if (mainThreadReady.empty()) {
+                lock.unlock();
+                bool ranJob = mJobSystem.TryRunOne();
+                lock.lock();
+
+                if (!ranJob && mainThreadReady.empty() && completed < count) {
+                    finished.wait(lock);
+                }
+                continue;
+            }
+
+            std::size_t index = mainThreadReady.back();
+            mainThreadReady.pop_back();
+
+            lock.unlock();
+            run(index, true);
+            lock.lock();
+
+            complete(index);
+        }
+    }
+
+    // Timings of every scheduled system from the last RunSystems, in schedule order
+    const std::vector<SystemTiming>& GetSystemTimings() const {
+        return mTimings;
+    }
+
 private:
-    std::unordered_map<const char*, Signature> mSignatures{};
+    struct ScheduledSystem {
+        std::shared_ptr<ISystem> system;
+        std::function<void(float)> update;
+        const char* name;
+    };
+
+    static bool Conflicts(const ISystem& a, const ISystem& b) {
+        if (a.mMainThreadOnly && b.mMainThreadOnly) {
+            return true;
+        }
 
-    std::unordered_map<const char*, std::shared_ptr<System>> mSystems{};
-};
\ No newline at end of file
+        return (a.mWrites & (b.mReads | b.mWrites)).any() || (b.mWrites & a.mReads).any();
+    }
+
+    // Indexed by system type, empty for types that were never registered
+    std::vector<std::shared_ptr<ISystem>> mSystems{};
+
+    std::vector<ScheduledSystem> mSchedule{};
+    std::vector<SystemTiming> mTimings{};
+
+    JobSystem& mJobSystem;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "coordinator.hpp"
+#include "types.hpp"
+#include "components.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Computes WorldMatrixComponent for every entity with a transform and a world matrix.
+// Entities with a HierarchyComponent are placed relative to their parent's world matrix.
+//
+// Entities are kept in an array sorted by depth in the hierarchy, so walking it level by
+// level finishes every parent before its children without any recursion. Each level is
+// split across the job system. Only entities whose transform or an ancestor changed since
+// the last update are recomputed, and the order is only rebuilt when membership or
+// parenting changes.
+class TransformSystem : public System<const TransformComponent, WorldMatrixComponent>
+{
+public:
+    std::shared_ptr<Coordinator> gCoordinator;
+
+    void Init(std::shared_ptr<Coordinator> coordinator);
+    void Update();
+
+private:
+    // Sorts mEntities by depth into mOrder and resolves each entity's parent position
+    void RebuildOrder();
+
+    // Entities sorted by depth, roots first
+    std::vector<Entity> mOrder;
+
+    // Position in mOrder of each entity's parent, NO_PARENT for roots
+    std::vector<std::uint32_t> mParents;
+
+    // mOrder[mLevelStarts[d]] is the first entity at depth d, with a final end marker
+    std::vector<std::size_t> mLevelStarts;
+
+    // Whether the entity at each position in mOrder was recomputed this update.
+    // Bytes rather than vector<bool> so parallel chunks never share a word.
+    std::vector<std::uint8_t> mUpdated;
+
+    std::uint32_t mOrderRevision = 0;
+    std::size_t mHierarchyCount = 0;
+    bool mOrderBuilt = false;
+    ChangeTick mLastTick = 0;
+
+    static constexpr std::uint32_t NO_PARENT = ~std::uint32_t(0);
+};
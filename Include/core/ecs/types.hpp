@@ -3,11 +3,96 @@
 #include <cstdint>
 #include <bitset>
 #include <array>
+#include <atomic>
+#include <type_traits>
 
+// An Entity is a handle packing a slot index (low ENTITY_INDEX_BITS) and the
+// generation of that slot (high bits). Destroying an entity bumps its slot's
+// generation, so handles kept around after destruction no longer match
+// anything once the slot is reused.
 using Entity = std::uint32_t;
 using ComponentType = std::uint8_t;
 
-const Entity MAX_ENTITIES = 5000;
+const std::uint32_t ENTITY_INDEX_BITS = 20;
+const Entity ENTITY_INDEX_MASK = (Entity(1) << ENTITY_INDEX_BITS) - 1;
+const Entity ENTITY_GENERATION_MASK = ~Entity(0) >> ENTITY_INDEX_BITS;
+
+// Handle that never refers to a live entity
+const Entity NULL_ENTITY = ~Entity(0);
+
+// Highest entity cap Coordinator::Init accepts, the all-ones index is reserved for NULL_ENTITY
+const Entity MAX_ENTITIES = ENTITY_INDEX_MASK;
+
+// Entity cap used when Coordinator::Init is not given one
+const Entity DEFAULT_MAX_ENTITIES = 5000;
 const ComponentType MAX_COMPONENTS = 32;
 
-using Signature = std::bitset<MAX_COMPONENTS>;
\ No newline at end of file
+using Signature = std::bitset<MAX_COMPONENTS>;
+
+// How the components of one type are laid out, chosen per type with ComponentStorage
+enum class StoragePolicy
+{
+    // Packed in pages in the order they were added. Removal moves the last component
+    // into the hole, so iteration never skips. The default for everything with data.
+    Dense,
+
+    // Paged by entity slot, so a component never moves while it exists and is found
+    // without going through the packed index. For components that are looked up more
+    // than iterated, or whose address is kept.
+    Sparse,
+
+    // No component storage at all, only which entities have the component. The default
+    // for empty types, e.g. marker components like "static" or "casts shadows".
+    Tag,
+
+    // At most one entity has the component, stored in a single slot
+    Singleton
+};
+
+// Specialize to pick the storage of a component type, e.g.
+//   template <>
+//   struct ComponentStorage<SkyComponent>
+//   {
+//       static constexpr StoragePolicy policy = StoragePolicy::Singleton;
+//   };
+template <typename T>
+struct ComponentStorage
+{
+    static constexpr StoragePolicy policy = std::is_empty_v<T> ? StoragePolicy::Tag : StoragePolicy::Dense;
+};
+
+// Frame counter stamped on components when they change. The coordinator advances it
+// once per RunSystems, so a tick identifies the frame a change happened in.
+using ChangeTick = std::uint32_t;
+
+inline Entity EntityIndex(Entity entity)
+{
+    return entity & ENTITY_INDEX_MASK;
+}
+
+inline std::uint32_t EntityGeneration(Entity entity)
+{
+    return entity >> ENTITY_INDEX_BITS;
+}
+
+inline Entity MakeEntity(Entity index, std::uint32_t generation)
+{
+    return (generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS | (index & ENTITY_INDEX_MASK);
+}
+
+// Hands out dense IDs per type, in order of first use. Each Family tag
+// gets its own sequence so component and system IDs both start at 0.
+template <typename Family>
+class TypeFamily
+{
+public:
+    template <typename T>
+    static std::uint32_t Id()
+    {
+        static const std::uint32_t id = sNextId++;
+        return id;
+    }
+
+private:
+    inline static std::atomic<std::uint32_t> sNextId{0};
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "component_array.hpp"
+#include "../job_system.hpp"
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Iterates every entity that has all of Ts... without going through System::mEntities.
+// The component arrays are resolved once when the view is created. Iteration walks the
+// packed column of the smallest array linearly and reaches the other arrays through
+// their sparse index, so no per-entity type lookup or hashing happens.
+template <typename... Ts>
+class ComponentView
+{
+public:
+    explicit ComponentView(ComponentArray<Ts> &...arrays) : mArrays(&arrays...)
+    {
+        std::size_t sizes[] = {arrays.Size()...};
+        std::size_t smallest = std::numeric_limits<std::size_t>::max();
+        for (std::size_t i = 0; i < sizeof...(Ts); ++i)
+        {
+            if (sizes[i] < smallest)
+            {
+                smallest = sizes[i];
+                mDriver = i;
+            }
+        }
+    }
+
+    // Calls func(entity, Ts&...) for every matching entity.
+    // Components of the current entity may be removed from inside func.
+    template <typename Func>
+    void Each(Func &&func)
+    {
+        EachDispatch(func, std::index_sequence_for<Ts...>{});
+    }
+
+    // Same as Each, but splits the packed range into chunks of grainSize entities that run
+    // as jobs. func must be safe to call concurrently for different entities and must not
+    // add or remove components while the view runs, record those in a CommandBuffer instead.
+    template <typename Func>
+    void ParallelEach(JobSystem &jobSystem, std::size_t grainSize, Func &&func)
+    {
+        ParallelEachDispatch(jobSystem, grainSize, func, std::index_sequence_for<Ts...>{});
+    }
+
+    // Calls func(entity, Ts&...) only for matching entities whose Changed component was
+    // added or marked changed in tick `since` or later. Walks Changed's tick column, so
+    // the cost follows the size of that array rather than the work done per entity.
+    template <typename Changed, typename Func>
+    void EachChangedSince(ChangeTick since, Func &&func)
+    {
+        EachChangedFrom<TypeIndex<Changed>()>(since, func, std::index_sequence_for<Ts...>{});
+    }
+
+    bool Contains(Entity entity) const
+    {
+        return (std::get<ComponentArray<Ts> *>(mArrays)->HasEntity(entity) && ...);
+    }
+
+    // Direct access to one of the view's components for an entity that has it, without
+    // the per-call type lookup of Coordinator::GetComponent
+    template <typename T>
+    T &Get(Entity entity)
+    {
+        return std::get<ComponentArray<T> *>(mArrays)->GetData(entity);
+    }
+
+    // Like Get, but marks the component as changed, see ComponentArray::Patch
+    template <typename T>
+    T &Patch(Entity entity)
+    {
+        return std::get<ComponentArray<T> *>(mArrays)->Patch(entity);
+    }
+
+    // Marks a component changed after writing it through the reference Each passed in
+    template <typename T>
+    void MarkChanged(Entity entity)
+    {
+        std::get<ComponentArray<T> *>(mArrays)->MarkChanged(entity);
+    }
+
+    template <typename T>
+    bool ChangedSince(Entity entity, ChangeTick since) const
+    {
+        return std::get<ComponentArray<T> *>(mArrays)->ChangedSince(entity, since);
+    }
+
+    // Upper bound on the number of matching entities
+    std::size_t SizeHint() const
+    {
+        std::size_t sizes[] = {std::get<ComponentArray<Ts> *>(mArrays)->Size()...};
+        return sizes[mDriver];
+    }
+
+private:
+    template <typename Func, std::size_t... Is>
+    void EachDispatch(Func &func, std::index_sequence<Is...> indices)
+    {
+        // Instantiate one loop per possible driving array so the driver is known at compile time
+        ((mDriver == Is ? EachFrom<Is>(func, indices, 0, std::get<Is>(mArrays)->Size()) : void()), ...);
+    }
+
+    template <typename Func, std::size_t... Is>
+    void ParallelEachDispatch(JobSystem &jobSystem, std::size_t grainSize, Func &func, std::index_sequence<Is...> indices)
+    {
+        ((mDriver == Is ? jobSystem.ParallelFor(0, std::get<Is>(mArrays)->Size(), grainSize, [&](std::size_t begin, std::size_t end)
+                                                { EachFrom<Is>(func, indices, begin, end); })
+                        : void()),
+         ...);
+    }
+
+    template <std::size_t Driver, typename Func, std::size_t... Is>
+    void EachFrom(Func &func, std::index_sequence<Is...>, std::size_t begin, std::size_t end)
+    {
+        auto &driver = *std::get<Driver>(mArrays);
+
+        // Walk back to front so the swap-and-pop of a removal inside func never skips an entity
+        for (std::size_t i = end; i-- > begin;)
+        {
+            if (i >= driver.Size())
+                continue;
+
+            Entity entity = driver.Entities()[i];
+            if (!Contains(entity))
+                continue;
+
+            func(entity, Fetch<Is, Driver>(entity, i)...);
+        }
+    }
+
+    template <std::size_t Driver, typename Func, std::size_t... Is>
+    void EachChangedFrom(ChangeTick since, Func &func, std::index_sequence<Is...>)
+    {
+        auto &driver = *std::get<Driver>(mArrays);
+
+        for (std::size_t i = driver.Size(); i-- > 0;)
+        {
+            if (i >= driver.Size() || driver.GetChangeTickAt(i) < since)
+                continue;
+
+            Entity entity = driver.Entities()[i];
+            if (!Contains(entity))
+                continue;
+
+            func(entity, Fetch<Is, Driver>(entity, i)...);
+        }
+    }
+
+    // Position of T in Ts...
+    template <typename T>
+    static constexpr std::size_t TypeIndex()
+    {
+        static_assert((std::is_same_v<T, Ts> || ...), "Type is not part of the view.");
+
+        std::size_t index = 0;
+        bool found = false;
+        ((found = found || std::is_same_v<T, Ts>, index += found ? 0 : 1), ...);
+        return index;
+    }
+
+    template <std::size_t I, std::size_t Driver>
+    auto &Fetch(Entity entity, std::size_t driverIndex)
+    {
+        // The driving array is already positioned on the entity, the rest go through the sparse index
+        if constexpr (I == Driver)
+            return std::get<I>(mArrays)->GetDataAt(driverIndex);
+        else
+            return std::get<I>(mArrays)->GetData(entity);
+    }
+
+    std::tuple<ComponentArray<Ts> *...> mArrays;
+
+    // Index in Ts... of the array with the fewest components
+    std::size_t mDriver{};
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bump allocator for data that only lives until the end of the frame. Allocating is a
+// pointer increment, freeing does nothing, and Reset() releases everything at once.
+// Once the arena has grown to the peak frame size it stops touching the heap.
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t blockSize = 64 * 1024);
+    ~FrameArena();
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+    // Invalidates every allocation made since the last reset. If the frame needed more
+    // than one block they are merged into one, so the next frame fits without growing.
+    void Reset();
+
+    // Bytes handed out since the last reset, including alignment padding
+    std::size_t BytesUsed() const { return mUsed; }
+
+    // Total bytes of all blocks owned by the arena
+    std::size_t Capacity() const;
+
+private:
+    struct Block
+    {
+        char *data;
+        std::size_t size;
+    };
+
+    void AddBlock(std::size_t size);
+
+    std::vector<Block> mBlocks;
+    std::size_t mBlockSize;
+    std::size_t mCurrent = 0;
+    std::size_t mOffset = 0;
+    std::size_t mUsed = 0;
+};
+
+// The calling thread's frame arena. Each thread resets only its own arena,
+// the RenderSystem resets the main thread's at the end of every frame.
+FrameArena &GetFrameArena();
+
+// STL allocator drawing from a FrameArena, by default the calling thread's.
+// Containers using it must not outlive the arena's next Reset().
+template <typename T>
+class FrameAllocator
+{
+public:
+    using value_type = T;
+
+    FrameAllocator() noexcept : mArena(&GetFrameArena()) {}
+    explicit FrameAllocator(FrameArena &arena) noexcept : mArena(&arena) {}
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &other) noexcept : mArena(other.mArena) {}
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(mArena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, std::size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U> &other) const noexcept { return mArena == other.mArena; }
+
+    template <typename U>
+    bool operator!=(const FrameAllocator<U> &other) const noexcept { return mArena != other.mArena; }
+
+private:
+    template <typename U>
+    friend class FrameAllocator;
+
+    FrameArena *mArena;
+};
+
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// printf-style formatting into a string on the calling thread's frame arena,
+// e.g. FrameFormat("pointLights[%d]", i) for uniform names
+FrameString FrameFormat(const char *format, ...);
+
+// Number of global operator new calls so far, on all threads. Take the difference
+// between two points to count heap allocations in between, e.g. over one frame.
+std::uint64_t GetHeapAllocationCount();
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks a group of jobs. Jobs submitted with a counter increment it and
+// decrement it when they finish, so JobSystem::Wait(counter) returns once
+// the whole group is done. Jobs submitted with SubmitAfter start only once
+// the counter they depend on reaches zero.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool IsDone() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        std::function<void()> task;
+        JobCounter *counter;
+    };
+
+    std::atomic<int> mPending{0};
+
+    std::mutex mMutex;
+    std::vector<Continuation> mContinuations;
+};
+
+// Work-stealing job system. Each worker owns a deque: it pushes and pops its own
+// jobs at the back and idle workers steal from the front of the others. Jobs
+// submitted from threads outside the pool go to a shared queue. Any thread may
+// help while it waits, so waiting on the main thread never leaves a core idle and
+// works with zero workers.
+class JobSystem
+{
+public:
+    // By default leaves one hardware thread for the main thread
+    explicit JobSystem(unsigned int workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    void Submit(std::function<void()> task, JobCounter *counter = nullptr);
+
+    // Queues task once dependency reaches zero, immediately if it already has
+    void SubmitAfter(JobCounter &dependency, std::function<void()> task, JobCounter *counter = nullptr);
+
+    // Runs other jobs on the calling thread until counter reaches zero.
+    // Only destroy a counter after waiting on it, not after polling IsDone().
+    void Wait(JobCounter &counter);
+
+    // Runs one queued job on the calling thread, returns false if there was none
+    bool TryRunOne();
+
+    // Calls func(chunkBegin, chunkEnd) over [begin, end) split into chunks of at most
+    // grainSize, in parallel, and returns once every chunk has run
+    void ParallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)> &func);
+
+    unsigned int GetWorkerCount() const { return static_cast<unsigned int>(mWorkers.size()); }
+
+private:
+    struct Job
+    {
+        std::function<void()> task;
+        JobCounter *counter = nullptr;
+    };
+
+    struct JobQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void Push(Job job);
+    bool Pop(Job &job);
+    void Run(Job &job);
+    void WorkerLoop(unsigned int index);
+
+    std::vector<std::thread> mWorkers;
+
+    // One queue per worker, plus a last one shared by threads outside the pool
+    std::vector<std::unique_ptr<JobQueue>> mQueues;
+
+    // Jobs sitting in any queue, lets idle workers sleep without missing work
+    std::atomic<int> mQueuedJobs{0};
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    std::atomic<bool> mStopping{false};
+};
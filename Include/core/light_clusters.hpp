@@ -0,0 +1,91 @@
+#pragma once
+
+#include "bounds.hpp"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Brightness under which a point light is treated as having no effect
+const float LIGHT_CUTOFF = 1.0f / 256.0f;
+
+// Distance at which brightness / (constant + linear * d + quadratic * d^2) falls to
+// LIGHT_CUTOFF, 0 if it never reaches it and infinite if it never falls below it
+float LightInfluenceRadius(float brightness, float constant, float linear, float quadratic);
+
+// Point light sphere in view space, the camera looks down -z
+struct ClusterLight
+{
+    glm::vec3 position;
+    float radius;
+};
+
+// Splits the view frustum into screen tiles times depth slices and lists, for each of
+// these clusters, the lights whose sphere reaches into it. Lighting shaders find the
+// cluster of a fragment the same way as ClusterOf and only loop over its lights.
+// Slice 0 runs from the near plane to FIRST_SLICE_DEPTH, the remaining slices split the
+// depth up to the far plane exponentially so clusters stay roughly cube shaped.
+class LightClusters
+{
+public:
+    static constexpr std::uint32_t TILES_X = 16;
+    static constexpr std::uint32_t TILES_Y = 9;
+    static constexpr std::uint32_t DEPTH_SLICES = 24;
+    static constexpr std::uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * DEPTH_SLICES;
+
+    // Lights past this in one cluster are dropped, in order of their index
+    static constexpr std::uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+    static constexpr float FIRST_SLICE_DEPTH = 0.5f;
+
+    // fovY in radians. Cluster bounds are only rebuilt when the frustum changes.
+    void SetFrustum(float fovY, float aspect, float nearPlane, float farPlane);
+
+    // Lists every light in each cluster its sphere touches, in ascending light order.
+    // Slices are assigned in parallel when a job system is given and there are enough lights
+    // to be worth it, otherwise on the calling thread without allocating once warmed up.
+    void Assign(const ClusterLight *lights, std::size_t count, JobSystem *jobSystem = nullptr);
+
+    // Index of the cluster holding a view space point inside the frustum
+    std::uint32_t ClusterOf(const glm::vec3 &position) const;
+
+    // First index into LightIndices() and light count, two values per cluster
+    const std::vector<std::uint32_t> &Ranges() const { return mRanges; }
+    const std::vector<std::uint32_t> &LightIndices() const { return mIndices; }
+
+    // View space bounds of a cluster
+    const AABB &Bounds(std::uint32_t cluster) const { return mBounds[cluster]; }
+
+    // Slices per unit of log depth past FIRST_SLICE_DEPTH, the shaders' slice mapping needs it
+    float SliceScale() const { return mSliceScale; }
+
+private:
+    std::uint32_t SliceOf(float depth) const;
+
+    // Depth at which a slice starts, SliceDepth(DEPTH_SLICES) is the far plane
+    float SliceDepth(std::uint32_t slice) const;
+
+    void CollectSlice(std::uint32_t slice, const ClusterLight *lights, std::size_t count);
+    void ScatterSlice(std::uint32_t slice);
+
+    float mTanHalfFovY = 0.0f;
+    float mAspect = 0.0f;
+    float mNear = 0.0f;
+    float mFar = 0.0f;
+    float mSliceScale = 0.0f;
+
+    std::vector<AABB> mBounds;
+
+    // First and last slice each light reaches
+    std::vector<std::uint32_t> mLightSlices;
+
+    // Per slice, the (tile << 24 | light) pairs found by its job and the light count of
+    // each of its clusters
+    std::vector<std::uint32_t> mSlicePairs[DEPTH_SLICES];
+    std::vector<std::uint32_t> mCounts;
+
+    std::vector<std::uint32_t> mRanges;
+    std::vector<std::uint32_t> mIndices;
+};
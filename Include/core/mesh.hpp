@@ -2,9 +2,14 @@
 
 #include <glad.h>
 #include <glm/glm.hpp>
+#include <cstddef>
 #include <vector>
 #include <string>
 
+// First of the four attribute locations the per instance model matrix of an instanced
+// draw takes, after the vertex attributes
+const unsigned int INSTANCE_MATRIX_LOCATION = 3;
+
 struct Vertex
 {
     glm::vec3 position;
@@ -21,6 +26,10 @@ public:
 
     void Draw() const;
 
+    // Draws count instances, instance i taking its model matrix from the mat4 at
+    // offset + i * sizeof(glm::mat4) in instanceBuffer
+    void DrawInstanced(GLsizei count, unsigned int instanceBuffer, std::size_t offset) const;
+
 private:
     void setupMesh();
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mesh.hpp"
+#include "bounds.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -21,6 +22,9 @@ public:
 
     std::vector<std::unique_ptr<Mesh>> meshes;
 
+    // Bounds of every vertex in model space, computed when loading
+    AABB bounds = AABB::Empty();
+
 private:
     void loadModel(const std::string &path, bool loadMaterials);
     void processNode(aiNode *node, const aiScene *scene, bool loadMaterials);
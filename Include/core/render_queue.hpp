@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Passes are submitted in this order
+enum class RenderPass : std::uint8_t
+{
+    // Depth tested and written, sorted by state and then front to back for early-z
+    Opaque = 0,
+
+    // Blended, sorted back to front ahead of state so blending composes correctly
+    Transparent = 1
+};
+
+// What a draw needs bound besides its program, filled in by the render modules
+struct DrawSortHints
+{
+    RenderPass pass = RenderPass::Opaque;
+
+    // Identifies the textures the draw binds, 0 for none. Draws with equal values share them.
+    std::uint32_t material = 0;
+
+    // Identifies the vertex data, e.g. RenderQueue::PointerKey of the model
+    std::uint32_t mesh = 0;
+};
+
+struct DrawItem
+{
+    std::uint64_t key;
+    std::uint32_t entity;
+    unsigned int program;
+};
+
+// Collects the draws of one scene render as 64 bit sort keys and orders them so that
+// draws sharing a program, then textures, then mesh follow each other. The key is laid out
+// high to low as
+//   opaque:      pass:2 | program:12 | material:16 | mesh:14 | depth:20
+//   transparent: pass:2 | far to near depth:20 | program:12 | material:16 | mesh:14
+// Fields are truncated to their width. A collision only costs batching, the submitter
+// still compares the actual program.
+class RenderQueue
+{
+public:
+    static constexpr int DEPTH_BITS = 20;
+
+    // depth is the view distance scaled to [0, 1], values outside are clamped
+    static std::uint64_t MakeKey(const DrawSortHints &hints, unsigned int program, float depth);
+
+    // Folds an address into a mesh or material key
+    static std::uint32_t PointerKey(const void *pointer);
+
+    // Whether two opaque keys agree on every field but depth, so their draws may share
+    // state. Transparent keys never do, their draws must stay in depth order.
+    static bool SameState(std::uint64_t a, std::uint64_t b)
+    {
+        return (a >> 62) == std::uint64_t(RenderPass::Opaque) && (a >> DEPTH_BITS) == (b >> DEPTH_BITS);
+    }
+
+    void Push(std::uint64_t key, std::uint32_t entity, unsigned int program)
+    {
+        mItems.push_back({key, entity, program});
+    }
+
+    // Stable LSD radix sort on the key, one pass per byte that is not the same in every item
+    void Sort();
+
+    void Clear() { mItems.clear(); }
+
+    std::size_t Size() const { return mItems.size(); }
+    bool Empty() const { return mItems.empty(); }
+
+    const DrawItem &operator[](std::size_t index) const { return mItems[index]; }
+    std::vector<DrawItem>::const_iterator begin() const { return mItems.begin(); }
+    std::vector<DrawItem>::const_iterator end() const { return mItems.end(); }
+
+private:
+    // Both keep their capacity between frames, so a steady scene sorts without allocating
+    std::vector<DrawItem> mItems;
+    std::vector<DrawItem> mScratch;
+};
@@ -14,6 +14,8 @@ public:
 
   void unbind() const;
 
+  unsigned int getID() const { return textureID; }
+
 private:
   unsigned int textureID = 0;
   int width = 0;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Index of a uniform name, shared by every program. Names are interned when handles are
+// created, so lookups during a frame compare integers instead of building strings.
+using UniformId = std::uint32_t;
+
+UniformId InternUniformName(std::string_view name);
+
+// Interns the names printf-style format gives for indices 0 to size - 1
+std::vector<UniformId> InternUniformArrayNames(const char *format, std::size_t size);
+
+// Binds a program's uniform block to a binding point, GLSL 330 cannot declare the binding.
+// Does nothing if the program has no active block of that name.
+void BindUniformBlock(unsigned int program, const char *name, unsigned int binding);
+
+// Uniform locations of one linked program. The program is reflected once with
+// glGetActiveUniform, after that a location is resolved at most once per name.
+class ProgramUniforms
+{
+public:
+    void Reflect(unsigned int program);
+
+    // -1 if the program has no active uniform of that name, which glUniform* ignores
+    GLint Location(UniformId id) const
+    {
+        if (id >= mLocations.size())
+            Resolve();
+        return mLocations[id];
+    }
+
+private:
+    void Resolve() const;
+
+    // Every active uniform, arrays also under their bare name and each element's name
+    std::unordered_map<std::string, GLint> mByName;
+
+    // By UniformId, extended as names are interned after the program was reflected
+    mutable std::vector<GLint> mLocations;
+};
+
+inline void UploadUniform(GLint location, const int *values, GLsizei count) { glUniform1iv(location, count, values); }
+inline void UploadUniform(GLint location, const float *values, GLsizei count) { glUniform1fv(location, count, values); }
+inline void UploadUniform(GLint location, const glm::vec2 *values, GLsizei count) { glUniform2fv(location, count, glm::value_ptr(values[0])); }
+inline void UploadUniform(GLint location, const glm::vec3 *values, GLsizei count) { glUniform3fv(location, count, glm::value_ptr(values[0])); }
+inline void UploadUniform(GLint location, const glm::vec4 *values, GLsizei count) { glUniform4fv(location, count, glm::value_ptr(values[0])); }
+inline void UploadUniform(GLint location, const glm::mat4 *values, GLsizei count) { glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(values[0])); }
+
+// Handle to a uniform of GLSL type matching T, declared once per module, e.g.
+//   const Uniform<glm::vec3> VIEW_POS("viewPos");
+//   VIEW_POS.Set(renderSystem->GetUniforms(program), camera.Position);
+// Use int for bool and sampler uniforms.
+template <typename T>
+class Uniform
+{
+public:
+    explicit Uniform(std::string_view name) : mId(InternUniformName(name)) {}
+
+    void Set(const ProgramUniforms &uniforms, const T &value) const
+    {
+        UploadUniform(uniforms.Location(mId), &value, 1);
+    }
+
+    // Fills the first count elements of an array uniform in one call
+    void Set(const ProgramUniforms &uniforms, const T *values, std::size_t count) const
+    {
+        if (count > 0)
+            UploadUniform(uniforms.Location(mId), values, static_cast<GLsizei>(count));
+    }
+
+private:
+    UniformId mId;
+};
+
+// Handles to one member of every element of a struct array, whose members GL does not
+// lay out contiguously, e.g.
+//   const UniformArray<float> WAVE_SPEED("waves[%d].speed", 32);
+//   WAVE_SPEED.Set(uniforms, i, wave.speed);
+template <typename T>
+class UniformArray
+{
+public:
+    UniformArray(const char *format, std::size_t size) : mIds(InternUniformArrayNames(format, size)) {}
+
+    void Set(const ProgramUniforms &uniforms, std::size_t index, const T &value) const
+    {
+        UploadUniform(uniforms.Location(mIds[index]), &value, 1);
+    }
+
+    std::size_t Size() const { return mIds.size(); }
+
+private:
+    std::vector<UniformId> mIds;
+};
+
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/ecs/snapshot.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -16,3 +17,17 @@ struct PBRMaterialComponent
     PBRMaterialComponent() = default;
     PBRMaterialComponent(std::shared_ptr<PBRMaterial> m) { materials.push_back(m); }
 };
+
+template <>
+struct SnapshotTraits<PBRMaterialComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const PBRMaterialComponent &component)
+    {
+        return WriteAssetRefs(writer, assets, component.materials);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, PBRMaterialComponent &component)
+    {
+        return ReadAssetRefs(reader, assets, component.materials);
+    }
+};
\ No newline at end of file
@@ -2,9 +2,10 @@
 
 #include <memory>
 #include <glm/glm.hpp>
+#include "core/ecs/snapshot.hpp"
+#include "physics/rigidbody.hpp"
 
 // Forward declarations
-class RigidBody;
 class Collider;
 
 struct ColliderComponent {
@@ -19,4 +20,36 @@ struct RigidbodyComponent {
 
     RigidbodyComponent() = default;
     explicit RigidbodyComponent(std::shared_ptr<RigidBody> rb) : rigidBody(std::move(rb)) {}
+};
+
+// Rigid bodies are per-entity simulation state rather than shared assets, so their
+// current values are stored inline and a fresh body is created on load
+template <>
+struct SnapshotTraits<RigidbodyComponent> {
+    static bool Write(SnapshotWriter& writer, const AssetRegistry&, const RigidbodyComponent& component) {
+        writer.Write(static_cast<std::uint8_t>(component.rigidBody ? 1 : 0));
+        if (component.rigidBody) {
+            writer.Write(*component.rigidBody);
+        }
+        return true;
+    }
+
+    static bool Read(SnapshotReader& reader, const AssetRegistry&, RigidbodyComponent& component) {
+        std::uint8_t hasBody = 0;
+        if (!reader.Read(hasBody)) {
+            return false;
+        }
+
+        component.rigidBody = nullptr;
+        if (!hasBody) {
+            return true;
+        }
+
+        RigidBody body;
+        if (!reader.Read(body)) {
+            return false;
+        }
+        component.rigidBody = std::make_shared<RigidBody>(body);
+        return true;
+    }
 };
\ No newline at end of file
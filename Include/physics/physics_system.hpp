@@ -6,18 +6,18 @@
 #include "physics/rigidbody.hpp"
 #include <memory>
 
-class PhysicsSystem : public System {
+class PhysicsSystem : public System<TransformComponent, RigidbodyComponent> {
 public:
-    void Update(std::shared_ptr<Coordinator> coordinator, float deltaTime) {
-        for (auto const& entity : mEntities) {
-            auto& transform = coordinator->GetComponent<TransformComponent>(entity);
-            auto& rigidComp = coordinator->GetComponent<RigidbodyComponent>(entity);
-
-            auto rb = rigidComp.rigidBody;
-            if (!rb) continue;
+    void Update(float deltaTime) {
+        // One view for the whole update, so marking transforms does not look their array up again
+        auto view = View();
+        view.ParallelEach(*mJobSystem, 256, [&view, deltaTime](Entity entity, TransformComponent& transform, RigidbodyComponent& rigidComp) {
+            auto& rb = rigidComp.rigidBody;
+            if (!rb) return;
 
             rb->ApplyGravity(deltaTime);
             rb->Integrate(deltaTime, transform.translation, transform.rotation);
-        }
+            view.MarkChanged<TransformComponent>(entity);
+        });
     }
 };
\ No newline at end of file
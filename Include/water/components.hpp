@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/ecs/snapshot.hpp"
+#include "core/ecs/types.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -15,4 +17,25 @@ struct WaterMeshComponent
 
     WaterMeshComponent() = default;
     WaterMeshComponent(std::shared_ptr<WaterMesh> waterMesh) : water(waterMesh) {}
+};
+
+// A scene has one water surface, so it is kept in a single slot
+template <>
+struct ComponentStorage<WaterMeshComponent>
+{
+    static constexpr StoragePolicy policy = StoragePolicy::Singleton;
+};
+
+template <>
+struct SnapshotTraits<WaterMeshComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const WaterMeshComponent &component)
+    {
+        return WriteAssetRef(writer, assets, component.water);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, WaterMeshComponent &component)
+    {
+        return ReadAssetRef(reader, assets, component.water);
+    }
 };
\ No newline at end of file
@@ -20,7 +20,11 @@ public:
 
   void InitOffscreenFramebuffers() override;
 
-  std::pair<std::string, std::string> GetShaders(RenderSystem *renderSystem, Entity e) const override;
+  std::pair<std::string_view, std::string_view> GetShaders(RenderSystem *renderSystem, Entity e) const override;
+
+  void GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const override;
+
+  bool CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const override;
 
   void UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e) override;
 
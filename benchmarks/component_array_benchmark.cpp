@@ -0,0 +1,85 @@
+// Throughput of ComponentArray get/has/insert/remove at several entity counts.
+// The ECS is header only, so this builds without a GL context or any other dependency:
+//   g++ -std=c++17 -O2 -DNDEBUG -IInclude benchmarks/component_array_benchmark.cpp -o component_array_benchmark
+
+#include "core/ecs/component_array.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+struct BenchComponent
+{
+    float position[3];
+    float velocity[3];
+};
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Report(const char *op, std::size_t count, double ms)
+{
+    double opsPerSecond = ms > 0.0 ? count / (ms / 1000.0) : 0.0;
+    std::printf("%-8s %9zu entities %10.3f ms %12.2f Mops/s\n", op, count, ms, opsPerSecond / 1e6);
+}
+
+void RunBenchmark(std::size_t count)
+{
+    std::vector<Entity> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+    ComponentArray<BenchComponent> array;
+
+    double insertMs = MeasureMillis([&]()
+    {
+        for (Entity e : order)
+            array.InsertData(e, BenchComponent{});
+    });
+    Report("insert", count, insertMs);
+
+    float sum = 0.0f;
+    double getMs = MeasureMillis([&]()
+    {
+        for (Entity e : order)
+            sum += array.GetData(e).position[0];
+    });
+    Report("get", count, getMs);
+
+    // Half of the probes use a stale generation of the same slot so the miss path is covered as well
+    std::size_t found = 0;
+    double hasMs = MeasureMillis([&]()
+    {
+        for (Entity e : order)
+            found += array.HasEntity(e) + array.HasEntity(MakeEntity(e, 1));
+    });
+    Report("has", count * 2, hasMs);
+
+    double removeMs = MeasureMillis([&]()
+    {
+        for (Entity e : order)
+            array.RemoveData(e);
+    });
+    Report("remove", count, removeMs);
+
+    // Keep the reads observable so they are not optimized away
+    if (sum != 0.0f || found != count)
+        std::printf("unexpected result\n");
+}
+
+int main()
+{
+    for (std::size_t count : {5000u, 100000u, 1000000u})
+    {
+        RunBenchmark(count);
+    }
+    return 0;
+}
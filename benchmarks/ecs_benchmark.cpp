@@ -0,0 +1,219 @@
+// Coordinator level ECS benchmarks: entity churn, component add/remove, random component
+// access, system iteration, signature changes and prefab instantiation at 1k to 1M entities. Needs no GL context.
+// Results are printed as JSON so runs can be diffed, pass a path to also write them to a file.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IInclude benchmarks/ecs_benchmark.cpp src/core/ecs/snapshot.cpp src/core/job_system.cpp -o ecs_benchmark
+//   ./ecs_benchmark [results.json]
+
+#include "core/ecs/coordinator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchPosition
+{
+    float x, y, z;
+};
+
+struct BenchVelocity
+{
+    float x, y, z;
+};
+
+struct BenchTag
+{
+};
+
+class MovementSystem : public System<BenchPosition, const BenchVelocity>
+{
+};
+
+class TaggedSystem : public System<const BenchPosition, const BenchTag>
+{
+};
+
+struct Result
+{
+    const char *name;
+    std::size_t entities;
+    int iterations;
+    std::size_t opsPerIteration;
+    double totalMs;
+};
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Each iteration builds a fresh world so every case starts from the same state
+void BenchCount(std::size_t count, std::vector<Result> &results)
+{
+    const int iterations = static_cast<int>(std::max<std::size_t>(1, 100000 / count));
+    enum Case
+    {
+        CREATE,
+        ADD,
+        GET_RANDOM,
+        ITERATE_SYSTEM,
+        ITERATE_VIEW,
+        SIGNATURE_CHANGE,
+        REMOVE,
+        DESTROY,
+        CREATE_REUSED,
+        INSTANTIATE,
+        CASE_COUNT
+    };
+    const char *names[CASE_COUNT] = {"create", "add_component", "get_component_random", "iterate_system",
+                                     "iterate_view", "signature_change", "remove_component", "destroy", "create_reused",
+                                     "instantiate_prefab"};
+    const std::size_t ops[CASE_COUNT] = {count, count * 2, count, count, count, count * 2, count, count, count, count};
+    double totals[CASE_COUNT] = {};
+
+    float sink = 0.0f;
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        Coordinator coordinator;
+        coordinator.Init(static_cast<Entity>(count));
+        coordinator.RegisterComponent<BenchPosition>();
+        coordinator.RegisterComponent<BenchVelocity>();
+        coordinator.RegisterComponent<BenchTag>();
+
+        auto movement = coordinator.RegisterSystem<MovementSystem>();
+        coordinator.ScheduleSystem<MovementSystem>([&movement](float dt)
+                                                   { movement->ForEach([dt](Entity, BenchPosition &position, const BenchVelocity &velocity)
+                                                                       {
+                position.x += velocity.x * dt;
+                position.y += velocity.y * dt;
+                position.z += velocity.z * dt; }); });
+
+        coordinator.RegisterSystem<TaggedSystem>();
+
+        std::vector<Entity> entities(count);
+        totals[CREATE] += MeasureMillis([&]()
+                                        {
+            for (Entity &entity : entities)
+                entity = coordinator.CreateEntity(); });
+
+        totals[ADD] += MeasureMillis([&]()
+                                     {
+            for (Entity entity : entities)
+            {
+                coordinator.AddComponent(entity, BenchPosition{0.0f, 0.0f, 0.0f});
+                coordinator.AddComponent(entity, BenchVelocity{1.0f, 2.0f, 3.0f});
+            } });
+
+        std::vector<Entity> shuffled = entities;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1234 + iteration));
+        totals[GET_RANDOM] += MeasureMillis([&]()
+                                            {
+            for (Entity entity : shuffled)
+                sink += coordinator.GetComponent<BenchPosition>(entity).x; });
+
+        totals[ITERATE_SYSTEM] += MeasureMillis([&]()
+                                                { coordinator.RunSystems(0.016f); });
+
+        totals[ITERATE_VIEW] += MeasureMillis([&]()
+                                              { coordinator.View<BenchPosition, BenchVelocity>().Each([](Entity, BenchPosition &position, BenchVelocity &velocity)
+                                                                                                      {
+                position.x += velocity.x;
+                position.y += velocity.y;
+                position.z += velocity.z; }); });
+
+        // Adding and removing the tag moves every entity into TaggedSystem and out again
+        totals[SIGNATURE_CHANGE] += MeasureMillis([&]()
+                                                  {
+            for (Entity entity : entities)
+                coordinator.AddComponent(entity, BenchTag{});
+            for (Entity entity : entities)
+                coordinator.RemoveComponent<BenchTag>(entity); });
+
+        totals[REMOVE] += MeasureMillis([&]()
+                                        {
+            for (Entity entity : shuffled)
+                coordinator.RemoveComponent<BenchVelocity>(entity); });
+
+        totals[DESTROY] += MeasureMillis([&]()
+                                         {
+            for (Entity entity : shuffled)
+                coordinator.DestroyEntity(entity); });
+
+        // Every slot is free again, so this measures creation through the free list
+        totals[CREATE_REUSED] += MeasureMillis([&]()
+                                               {
+            for (Entity &entity : entities)
+                entity = coordinator.CreateEntity(); });
+
+        // Same result as create plus add_component through the batched prefab path, in a
+        // fresh world so both start from unused entity slots
+        Coordinator spawnWorld;
+        spawnWorld.Init(static_cast<Entity>(count));
+        spawnWorld.RegisterComponent<BenchPosition>();
+        spawnWorld.RegisterComponent<BenchVelocity>();
+        spawnWorld.RegisterSystem<MovementSystem>();
+
+        Prefab prefab;
+        prefab.Add(BenchPosition{0.0f, 0.0f, 0.0f}).Add(BenchVelocity{1.0f, 2.0f, 3.0f});
+        totals[INSTANTIATE] += MeasureMillis([&]()
+                                             { entities = spawnWorld.Instantiate(prefab, count); });
+    }
+
+    for (int i = 0; i < CASE_COUNT; ++i)
+    {
+        results.push_back({names[i], count, iterations, ops[i], totals[i]});
+    }
+
+    // Keep the reads observable so they are not optimized away, positions are read before moving
+    if (sink != 0.0f)
+        std::fprintf(stderr, "unexpected result\n");
+}
+
+std::string ToJson(const std::vector<Result> &results)
+{
+    std::string json = "{\n  \"benchmark\": \"ecs\",\n  \"results\": [\n";
+    char line[256];
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+        double perIterationMs = result.totalMs / result.iterations;
+        double nsPerOp = perIterationMs * 1e6 / result.opsPerIteration;
+        std::snprintf(line, sizeof(line),
+                      "    {\"case\": \"%s\", \"entities\": %zu, \"iterations\": %d, \"ms\": %.4f, \"ns_per_op\": %.3f}%s\n",
+                      result.name, result.entities, result.iterations, perIterationMs, nsPerOp,
+                      i + 1 < results.size() ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Result> results;
+    for (std::size_t count : {1000u, 10000u, 100000u, 1000000u})
+    {
+        BenchCount(count, results);
+    }
+
+    std::string json = ToJson(results);
+    std::fputs(json.c_str(), stdout);
+
+    if (argc > 1)
+    {
+        std::FILE *file = std::fopen(argv[1], "w");
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to open %s\n", argv[1]);
+            return 1;
+        }
+        std::fputs(json.c_str(), file);
+        std::fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Per-job scheduling overhead of JobSystem and how a synthetic workload scales with worker count.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IInclude benchmarks/job_system_benchmark.cpp src/core/job_system.cpp -o job_system_benchmark
+
+#include "core/job_system.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Empty jobs, so the time is almost entirely submit, pop, run and counter bookkeeping
+void BenchOverhead(unsigned int workers)
+{
+    const int jobCount = 200000;
+    JobSystem jobs(workers);
+    std::atomic<int> ran{0};
+
+    double ms = MeasureMillis([&]()
+                              {
+        JobCounter counter;
+        for (int i = 0; i < jobCount; ++i)
+        {
+            jobs.Submit([&ran]()
+                        { ran.fetch_add(1, std::memory_order_relaxed); },
+                        &counter);
+        }
+        jobs.Wait(counter); });
+
+    std::printf("overhead  %2u workers  %8d jobs  %8.2f ms  %7.1f ns/job\n", workers, ran.load(), ms, ms * 1e6 / jobCount);
+}
+
+// CPU bound work split with ParallelFor, roughly what a physics or skinning pass looks like
+void BenchScaling(unsigned int workers, double baselineMs, double &measuredMs)
+{
+    const std::size_t count = 1 << 20;
+    std::vector<float> values(count, 1.0f);
+    JobSystem jobs(workers);
+
+    measuredMs = MeasureMillis([&]()
+                               {
+        for (int pass = 0; pass < 8; ++pass)
+        {
+            jobs.ParallelFor(0, count, 4096, [&values](std::size_t begin, std::size_t end)
+                             {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    values[i] = std::sqrt(values[i] * 1.0001f + 0.5f) * std::sin(values[i]);
+                }
+            });
+        } });
+
+    double speedup = measuredMs > 0.0 ? (baselineMs > 0.0 ? baselineMs : measuredMs) / measuredMs : 0.0;
+    std::printf("scaling   %2u workers  %8.2f ms  %5.2fx  (checksum %f)\n", workers, measuredMs, speedup, values[count / 2]);
+}
+
+int main()
+{
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int workers = 0; workers < hardware; workers = workers ? workers * 2 : 1)
+    {
+        BenchOverhead(workers);
+    }
+
+    // The calling thread helps while it waits, so 0 workers is the single threaded baseline
+    double baselineMs = 0.0;
+    for (unsigned int workers = 0; workers < hardware; workers = workers ? workers * 2 : 1)
+    {
+        double ms = 0.0;
+        BenchScaling(workers, baselineMs, ms);
+        if (workers == 0)
+            baselineMs = ms;
+    }
+    return 0;
+}
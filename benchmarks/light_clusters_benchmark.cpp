@@ -0,0 +1,80 @@
+// LightClusters assignment of 1k to 16k point lights scattered in front of the camera,
+// on the calling thread against spread over the JobSystem, and the average number of
+// lights a fragment in a lit cluster loops over instead of every light.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IInclude -I<glm> benchmarks/light_clusters_benchmark.cpp src/core/light_clusters.cpp src/core/job_system.cpp -o light_clusters_benchmark
+
+#include "core/job_system.hpp"
+#include "core/light_clusters.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main()
+{
+    const int runs = 20;
+    const std::size_t counts[] = {1000, 4000, 16000};
+    JobSystem jobs;
+
+    LightClusters clusters;
+    clusters.SetFrustum(glm::radians(45.0f), 16.0f / 12.0f, 0.01f, 1000.0f);
+
+    for (std::size_t count : counts)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> side(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> depth(1.0f, 200.0f);
+        std::uniform_real_distribution<float> radius(2.0f, 10.0f);
+
+        std::vector<ClusterLight> lights(count);
+        for (ClusterLight &light : lights)
+            light = {glm::vec3(side(rng), side(rng) * 0.6f, -depth(rng)), radius(rng)};
+
+        // Warm up so the per slice buffers have grown to their steady size
+        clusters.Assign(lights.data(), lights.size());
+
+        double serialMillis = 0.0;
+        for (int run = 0; run < runs; ++run)
+            serialMillis += MeasureMillis([&]()
+                                          { clusters.Assign(lights.data(), lights.size()); });
+        std::vector<std::uint32_t> serialIndices = clusters.LightIndices();
+
+        double parallelMillis = 0.0;
+        for (int run = 0; run < runs; ++run)
+            parallelMillis += MeasureMillis([&]()
+                                            { clusters.Assign(lights.data(), lights.size(), &jobs); });
+
+        if (clusters.LightIndices() != serialIndices)
+        {
+            std::printf("parallel assignment differs from serial\n");
+            return 1;
+        }
+
+        std::size_t used = 0;
+        std::size_t lightsPerCluster = 0;
+        const std::vector<std::uint32_t> &ranges = clusters.Ranges();
+        for (std::size_t i = 0; i < ranges.size(); i += 2)
+        {
+            if (ranges[i + 1] == 0)
+                continue;
+            ++used;
+            lightsPerCluster += ranges[i + 1];
+        }
+
+        std::printf("%zu lights\n", count);
+        std::printf("  assign serial     %8.3f ms\n", serialMillis / runs);
+        std::printf("  assign jobs       %8.3f ms (%u workers)\n", parallelMillis / runs, jobs.GetWorkerCount());
+        std::printf("  lit clusters      %8zu of %u, %.1f lights each\n", used, LightClusters::CLUSTER_COUNT,
+                    used ? static_cast<double>(lightsPerCluster) / used : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Save and restore time of a world snapshot at several entity counts. Every entity gets a
+// raw column component, half of them also reference a shared asset by name.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IInclude benchmarks/snapshot_benchmark.cpp src/core/ecs/snapshot.cpp src/core/job_system.cpp -o snapshot_benchmark
+
+#include "core/ecs/coordinator.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+struct BenchTransform
+{
+    float translation[3];
+    float rotation[3];
+    float scale[3];
+};
+
+struct BenchMesh
+{
+    int vertexCount;
+};
+
+struct BenchMeshComponent
+{
+    std::shared_ptr<BenchMesh> mesh;
+};
+
+template <>
+struct SnapshotTraits<BenchMeshComponent>
+{
+    static bool Write(SnapshotWriter &writer, const AssetRegistry &assets, const BenchMeshComponent &component)
+    {
+        return WriteAssetRef(writer, assets, component.mesh);
+    }
+
+    static bool Read(SnapshotReader &reader, const AssetRegistry &assets, BenchMeshComponent &component)
+    {
+        return ReadAssetRef(reader, assets, component.mesh);
+    }
+};
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Bench(Entity count)
+{
+    AssetRegistry assets;
+    auto mesh = std::make_shared<BenchMesh>(BenchMesh{36});
+    assets.Register("mesh", mesh);
+
+    Coordinator coordinator;
+    coordinator.Init(count);
+    coordinator.RegisterComponent<BenchTransform>();
+    coordinator.RegisterComponent<BenchMeshComponent>();
+
+    for (Entity i = 0; i < count; ++i)
+    {
+        Entity entity = coordinator.CreateEntity();
+        float f = static_cast<float>(i);
+        coordinator.AddComponent(entity, BenchTransform{{f, f, f}, {0, 0, 0}, {1, 1, 1}});
+        if (i % 2 == 0)
+            coordinator.AddComponent(entity, BenchMeshComponent{mesh});
+    }
+
+    const std::string path = "snapshot_benchmark.bin";
+    bool saved = false;
+    bool loaded = false;
+    double saveMs = MeasureMillis([&]()
+                                  { saved = coordinator.SaveSnapshot(path, assets); });
+    double loadMs = MeasureMillis([&]()
+                                  { loaded = coordinator.LoadSnapshot(path, assets); });
+    std::remove(path.c_str());
+
+    std::printf("%8u entities  save %8.2f ms  load %8.2f ms  %s\n", count, saveMs, loadMs, saved && loaded ? "" : "(failed)");
+}
+
+int main()
+{
+    for (Entity count : {5000u, 100000u, 1000000u})
+    {
+        Bench(count);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// SpatialIndexSystem on 100k entities scattered over a 1km cube: building the tree, incremental
+// refits when a fraction of the entities moves a little (inside the tree margin) or a lot
+// (reinsertion), and box, sphere and k-nearest queries.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -IInclude -IExternal -I<glm> -I<assimp> benchmarks/spatial_index_benchmark.cpp src/core/aabb_tree.cpp src/core/ecs/spatial_index_system.cpp src/core/ecs/snapshot.cpp src/core/job_system.cpp -o spatial_index_benchmark
+
+#include "core/ecs/spatial_index_system.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+template <typename Func>
+double MeasureMillis(Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main()
+{
+    const std::size_t count = 100000;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+    auto coordinator = std::make_shared<Coordinator>();
+    coordinator->Init(count);
+    coordinator->RegisterComponent<TransformComponent>();
+    coordinator->RegisterComponent<WorldMatrixComponent>();
+    coordinator->RegisterComponent<ModelComponent>();
+    coordinator->RegisterComponent<BoundsComponent>();
+
+    auto system = coordinator->RegisterSystem<SpatialIndexSystem>();
+    Signature signature;
+    signature.set(coordinator->GetComponentType<TransformComponent>());
+    coordinator->SetSystemSignature<SpatialIndexSystem>(signature);
+    system->Init(coordinator);
+
+    std::vector<Entity> entities;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Entity entity = coordinator->CreateEntity();
+        TransformComponent transform{};
+        transform.translation = {position(rng), position(rng), position(rng)};
+        coordinator->AddComponent(entity, transform);
+        float extent = size(rng);
+        coordinator->AddComponent(entity, BoundsComponent{AABB{glm::vec3(-extent), glm::vec3(extent)}});
+        entities.push_back(entity);
+    }
+
+    // Each measurement is one frame, the coordinator advances the change tick per RunSystems
+    auto frame = [&]()
+    {
+        coordinator->RunSystems(0.0f);
+        system->Update();
+    };
+
+    double buildMs = MeasureMillis(frame);
+    std::printf("build        %7zu entities  %8.3f ms  height %d\n", count, buildMs, system->GetTree().GetHeight());
+    frame();
+    std::printf("unchanged    %7zu entities  %8.3f ms\n", count, MeasureMillis(frame));
+
+    // Moves every stride-th entity by distance on x, then lets the change age out
+    auto moveFrame = [&](std::size_t stride, float distance)
+    {
+        double ms = MeasureMillis([&]()
+                                  {
+            coordinator->RunSystems(0.0f);
+            for (std::size_t i = 0; i < count; i += stride)
+                coordinator->PatchComponent<TransformComponent>(entities[i]).translation.x += distance;
+            system->Update(); });
+        frame();
+        return ms;
+    };
+
+    for (std::size_t stride : {100, 10, 1})
+    {
+        double smallMs = moveFrame(stride, 0.05f);
+        double largeMs = moveFrame(stride, 5.0f);
+        std::printf("%3zu%% moved  %7zu entities  %8.3f ms inside margin  %8.3f ms reinserted\n",
+                    100 / stride, count / stride, smallMs, largeMs);
+    }
+
+    const int queries = 1000;
+    std::size_t hits = 0;
+    std::vector<glm::vec3> centers;
+    for (int i = 0; i < queries; ++i)
+    {
+        centers.push_back({position(rng), position(rng), position(rng)});
+    }
+
+    double boxMs = MeasureMillis([&]()
+                                 {
+        for (const glm::vec3 &center : centers)
+            system->QueryBox(AABB{center - glm::vec3(20.0f), center + glm::vec3(20.0f)}, [&hits](Entity, const AABB &)
+                             { ++hits; }); });
+    double sphereMs = MeasureMillis([&]()
+                                    {
+        for (const glm::vec3 &center : centers)
+            system->QuerySphere(center, 20.0f, [&hits](Entity, const AABB &)
+                                { ++hits; }); });
+    std::vector<Entity> nearest;
+    AABBTree::NearestScratch nearestScratch;
+    double nearestMs = MeasureMillis([&]()
+                                     {
+        for (const glm::vec3 &center : centers)
+        {
+            system->QueryNearest(center, 8, nearest, nearestScratch);
+            hits += nearest.size();
+        } });
+
+    std::printf("box query    %8.2f us  sphere query %8.2f us  8-nearest %8.2f us  (%zu hits)\n",
+                boxMs * 1000.0 / queries, sphereMs * 1000.0 / queries, nearestMs * 1000.0 / queries, hits);
+    return 0;
+}
@@ -11,14 +11,18 @@ out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
-uniform mat4 boneMatrices[100];
+// Camera, time and clipping plane of the pass, filled by RenderSystem, see FrameUniforms
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 clipPlane;
+    vec3 viewPos;
+    float time;
+    bool enableClip;
+};
 
-// Clipping plane, required in all vertex shaders for modules
-uniform vec4 clipPlane;
-uniform bool enableClip;
+uniform mat4 boneMatrices[100];
 
 void main() {
     mat4 skinMatrix = boneMatrices[inBoneIDs.x] * inBoneWeights.x +
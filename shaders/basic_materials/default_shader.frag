@@ -1,14 +1,13 @@
 #version 330 core
 
-#define MAX_POINT_LIGHTS 64
-
 struct PointLight {
     vec3 position;
-    vec3 color;
     float intensity;
+    vec3 color;
     float constant;
     float linear;
     float quadratic;
+    float radius;
 };
 
 in vec2 TexCoords;
@@ -16,14 +15,52 @@ in vec3 Normal;
 in vec3 FragPos;
 out vec4 FragColor;
 
-uniform vec3 viewPos;
+// Camera, time and clipping plane of the pass, filled by RenderSystem, see FrameUniforms
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 clipPlane;
+    vec3 viewPos;
+    float time;
+    bool enableClip;
+};
+
 uniform vec3 materialAlbedo;      
 uniform sampler2D albedoMap;    
 uniform bool useAlbedoMap;
 uniform bool ignoreLighting;
 
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform int numPointLights;
+// Clustered point lights, filled once per pass by RenderSystem, see LightUniforms and LightClusters
+layout(std140) uniform LightData {
+    uvec4 clusterGrid;  // tiles x, tiles y, depth slices, light count
+    vec4 clusterDepth;  // depth where slice 1 starts, slices per unit of log depth
+};
+uniform samplerBuffer lightTexels;    // three texels per light
+uniform usamplerBuffer clusterRanges; // first index into clusterLights and light count per cluster
+uniform usamplerBuffer clusterLights; // light indices of every cluster back to back
+
+PointLight FetchLight(int index) {
+    vec4 t0 = texelFetch(lightTexels, index * 3);
+    vec4 t1 = texelFetch(lightTexels, index * 3 + 1);
+    vec4 t2 = texelFetch(lightTexels, index * 3 + 2);
+    return PointLight(t0.xyz, t0.w, t1.xyz, t1.w, t2.x, t2.y, t2.z);
+}
+
+// Lights of the cluster holding a world space position, see LightClusters::ClusterOf
+uvec2 ClusterRange(vec3 worldPos) {
+    vec4 viewPosition = view * vec4(worldPos, 1.0);
+    vec4 clip = projection * viewPosition;
+    vec2 tiles = vec2(clusterGrid.xy);
+    uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * tiles, vec2(0.0), tiles - 1.0));
+
+    float depth = -viewPosition.z;
+    uint slice = 0u;
+    if (depth >= clusterDepth.x)
+        slice = min(uint(log(depth / clusterDepth.x) * clusterDepth.y + 1.0), clusterGrid.z - 1u);
+
+    int cluster = int((slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x);
+    return texelFetch(clusterRanges, cluster).rg;
+}
 
 void main() {
     vec3 albedo = materialAlbedo;
@@ -41,10 +78,16 @@ void main() {
 
     vec3 lighting = vec3(0.0);
 
-    // Loop over all point lights
-    for (int i = 0; i < numPointLights; i++)
+    // Loop over the point lights reaching this fragment's cluster
+    uvec2 lightRange = ClusterRange(FragPos);
+    for (uint i = 0u; i < lightRange.y; i++)
     {
-        PointLight light = pointLights[i];
+        PointLight light = FetchLight(int(texelFetch(clusterLights, int(lightRange.x + i)).r));
+
+        // Lights end at their radius, the same cutoff used to assign them to clusters
+        float distance = length(light.position - FragPos);
+        if (distance > light.radius)
+            continue;
 
         // Direction from fragment to light
         vec3 lightDir = normalize(light.position - FragPos);
@@ -57,7 +100,6 @@ void main() {
         float spec = pow(max(dot(norm, halfwayDir), 0.0), 32.0);
 
         // Attenuation
-        float distance    = length(light.position - FragPos);
         float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
         // Combine
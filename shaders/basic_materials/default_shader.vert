@@ -8,13 +8,24 @@ out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
+// RenderSystem compiles an INSTANCED variant for batches of entities sharing a model,
+// taking the model matrix per instance, see Mesh::DrawInstanced
+#ifdef INSTANCED
+layout(location = 3) in mat4 instanceModel;
+#define model instanceModel
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
 
-// Clipping plane, required in all vertex shaders for modules
-uniform vec4 clipPlane;
-uniform bool enableClip;
+// Camera, time and clipping plane of the pass, filled by RenderSystem, see FrameUniforms
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 clipPlane;
+    vec3 viewPos;
+    float time;
+    bool enableClip;
+};
 
 void main() {
     vec4 worldPos = model * vec4(aPos, 1.0);
@@ -6,7 +6,6 @@ in vec2 vTexPos;
 
 out vec4 FragColor;
 
-uniform vec3 cameraPos;
 uniform sampler2D reflectionTex;
 uniform sampler2D refractionTex;
 uniform sampler2D dudvMap;
@@ -14,17 +13,26 @@ uniform sampler2D normalMap;
 
 uniform vec3 sunDir;
 uniform vec3 sunColor;
-uniform float time;
 uniform vec3 deepColor; // underwater color
 uniform float foamThreshold; // control foam
 
+// Camera, time and clipping plane of the pass, filled by RenderSystem, see FrameUniforms
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 clipPlane;
+    vec3 viewPos;
+    float time;
+    bool enableClip;
+};
+
 float fresnelSchlick(float cosTheta, float f0) {
     return f0 + (1.0 - f0) * pow(1.0 - cosTheta, 5.0);
 }
 
 void main() {
     vec3 N = normalize(vNormal);
-    vec3 V = normalize(cameraPos - vWorldPos);
+    vec3 V = normalize(viewPos - vWorldPos);
 
     // Fresnel (Schlick)
     float cosTheta = max(dot(N, V), 0.0);
@@ -8,11 +8,18 @@ out vec4 vClipPos;
 out vec2 vTexPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;
 uniform int numWaves;
 
+// Camera, time and clipping plane of the pass, filled by RenderSystem, see FrameUniforms
+layout(std140) uniform FrameData {
+  mat4 view;
+  mat4 projection;
+  vec4 clipPlane;
+  vec3 viewPos;
+  float time;
+  bool enableClip;
+};
+
 struct Wave {
   vec2 dir;
   float wavelength;
@@ -23,10 +30,6 @@ struct Wave {
 
 uniform Wave waves[32]; // set numWaves <= 32
 
-// Clipping plane, required in all vertex shaders for modules
-uniform vec4 clipPlane;
-uniform bool enableClip;
-
 // gerstner function for a single wave
 vec3 gerstnerWave(vec3 pos, Wave w, float t) {
   float k = 2.0 * 3.14159265 / w.wavelength;
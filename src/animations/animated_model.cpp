@@ -42,6 +42,11 @@ std::unique_ptr<AnimatedMesh> AnimatedModel::processMesh(aiMesh *mesh, const aiS
     std::vector<AnimatedVertex> vertices = loadVertices(mesh);
     std::vector<unsigned int> indices = loadIndices(mesh);
 
+    for (const AnimatedVertex &vertex : vertices)
+    {
+        bounds.Grow(vertex.position);
+    }
+
     loadBones(mesh, vertices);
 
     auto animatedMesh = std::make_unique<AnimatedMesh>(vertices, indices);
@@ -1,8 +1,18 @@
 #include "animations/animations_render_module.hpp"
 #include "animations/animated_model.hpp"
 #include "animations/components.hpp"
+#include <algorithm>
 
-std::pair<std::string, std::string> AnimationsObjectModule::GetShaders(RenderSystem *renderSystem, Entity e) const
+namespace
+{
+  // Size of the boneMatrices array in the animated shader
+  const std::size_t MAX_BONES = 100;
+
+  const Uniform<glm::mat4> MODEL("model");
+  const Uniform<glm::mat4> BONE_MATRICES("boneMatrices");
+}
+
+std::pair<std::string_view, std::string_view> AnimationsObjectModule::GetShaders(RenderSystem *renderSystem, Entity e) const
 {
   if (!renderSystem->gCoordinator->HasComponent<AnimatedModelComponent>(e))
   {
@@ -11,40 +21,47 @@ std::pair<std::string, std::string> AnimationsObjectModule::GetShaders(RenderSys
   return {"shaders/animated_meshes/animated_shader.vert", ""};
 }
 
-void AnimationsObjectModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+void AnimationsObjectModule::GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const
 {
   if (!renderSystem->gCoordinator->HasComponent<AnimatedModelComponent>(e))
   {
     return;
   }
 
-  glm::mat4 view = camera.getViewMatrix();
-  glm::mat4 proj = camera.getProjectionMatrix(16.0f / 12.0f);
+  hints.mesh = RenderQueue::PointerKey(renderSystem->gCoordinator->GetComponent<AnimatedModelComponent>(e).model.get());
+}
 
-  glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-  glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+bool AnimationsObjectModule::CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const
+{
+  // Every animated entity has its own bone palette
+  return !renderSystem->gCoordinator->HasComponent<AnimatedModelComponent>(first) &&
+         !renderSystem->gCoordinator->HasComponent<AnimatedModelComponent>(other);
+}
+
+void AnimationsObjectModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+{
+  if (!renderSystem->gCoordinator->HasComponent<AnimatedModelComponent>(e))
+  {
+    return;
+  }
+
+  // View and projection come from the frame uniform block
+  const ProgramUniforms &uniforms = renderSystem->GetUniforms(program);
 
   auto &animModelComp = renderSystem->gCoordinator->GetComponent<AnimatedModelComponent>(e);
   auto &animatedModel = *animModelComp.model;
 
+  // The whole palette goes up in one call
   const std::vector<glm::mat4> &boneMatrices = animatedModel.GetFinalBoneMatrices();
-
-  for (size_t i = 0; i < boneMatrices.size() && i < 100; ++i)
-  {
-    std::string name = "boneMatrices[" + std::to_string(i) + "]";
-    glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE, glm::value_ptr(boneMatrices[i]));
-  }
+  BONE_MATRICES.Set(uniforms, boneMatrices.data(), std::min(boneMatrices.size(), MAX_BONES));
 
   if (!renderSystem->gCoordinator->HasComponent<TransformComponent>(e))
   {
-    glm::mat4 defaultModel(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(defaultModel));
+    MODEL.Set(uniforms, glm::mat4(1.0f));
     return;
   }
 
-  auto &transform = renderSystem->gCoordinator->GetComponent<TransformComponent>(e);
-  glm::mat4 model = transform.GetMatrix();
-  glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+  MODEL.Set(uniforms, renderSystem->GetModelMatrix(e));
 }
 
 void AnimationsObjectModule::DrawObject(unsigned int program, RenderSystem *renderSystem, Entity e)
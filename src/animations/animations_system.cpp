@@ -16,20 +16,14 @@ void AnimationsSystem::Init(std::shared_ptr<Coordinator> coordinator)
 
 void AnimationsSystem::Update(float deltaTime, const Camera &camera)
 {
-    for (auto const &entity : mEntities)
+    // Serial: entities can share an Animation or AnimatedModel through their shared_ptrs, and
+    // updating one writes its bone matrices and binds the model's pose in place
+    ForEach([deltaTime](Entity entity, AnimationComponent &animComp, AnimatedModelComponent &animModelComp)
     {
-        if (!gCoordinator->HasComponent<AnimationComponent>(entity) || !gCoordinator->HasComponent<AnimatedModelComponent>(entity))
-        {
-            continue;
-        }
-
-        auto &animComp = gCoordinator->GetComponent<AnimationComponent>(entity);
-        auto &animModelComp = gCoordinator->GetComponent<AnimatedModelComponent>(entity);
-
         if (!animComp.animation || !animComp.playing)
         {
             animModelComp.model->UnbindAnimation();
-            continue;
+            return;
         }
 
         animComp.currentTime += deltaTime;
@@ -48,5 +42,5 @@ void AnimationsSystem::Update(float deltaTime, const Camera &camera)
         }
 
         animModelComp.model->BindAnimation(animComp.animation->GetFinalBoneMatrices());
-    }
+    });
 }
@@ -0,0 +1,399 @@
+#include "core/aabb_tree.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+
+std::int32_t AABBTree::CreateProxy(const AABB &bounds, Entity entity)
+{
+    std::int32_t proxy = AllocateNode();
+    mNodes[proxy].fat = bounds.Expanded(mMargin);
+    mNodes[proxy].entity = entity;
+    mBounds[proxy] = bounds;
+
+    InsertLeaf(proxy);
+    ++mProxyCount;
+    return proxy;
+}
+
+void AABBTree::DestroyProxy(std::int32_t proxy)
+{
+    assert(proxy >= 0 && static_cast<std::size_t>(proxy) < mNodes.size() && mNodes[proxy].height == 0 && "Destroying an invalid proxy.");
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --mProxyCount;
+}
+
+void AABBTree::CreateProxies(const AABB *bounds, const Entity *entities, std::size_t count, std::int32_t *proxies)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::int32_t proxy = AllocateNode();
+        mNodes[proxy].fat = bounds[i].Expanded(mMargin);
+        mNodes[proxy].entity = entities[i];
+        mBounds[proxy] = bounds[i];
+        proxies[i] = proxy;
+    }
+    mProxyCount += count;
+
+    Rebuild();
+}
+
+void AABBTree::Rebuild()
+{
+    // Internal nodes are recreated, leaves keep their ids
+    std::vector<std::int32_t> leaves;
+    leaves.reserve(mProxyCount);
+    for (std::size_t i = 0; i < mNodes.size(); ++i)
+    {
+        Node &node = mNodes[i];
+        if (node.height < 0)
+            continue;
+
+        if (node.IsLeaf())
+            leaves.push_back(static_cast<std::int32_t>(i));
+        else
+            FreeNode(static_cast<std::int32_t>(i));
+    }
+
+    mRoot = leaves.empty() ? NULL_NODE : BuildTopDown(leaves, 0, leaves.size());
+    if (mRoot != NULL_NODE)
+        mNodes[mRoot].parent = NULL_NODE;
+}
+
+bool AABBTree::MoveProxy(std::int32_t proxy, const AABB &bounds)
+{
+    assert(proxy >= 0 && static_cast<std::size_t>(proxy) < mNodes.size() && mNodes[proxy].height == 0 && "Moving an invalid proxy.");
+
+    mBounds[proxy] = bounds;
+
+    // A fat box that has grown far around the bounds, e.g. after the entity shrank,
+    // is refitted as well so it does not keep catching unrelated queries
+    const AABB &fat = mNodes[proxy].fat;
+    if (fat.Contains(bounds) && bounds.Expanded(mMargin * 4.0f).Contains(fat))
+        return false;
+
+    // Reinsert from the lowest ancestor that already encloses the new box. Entities mostly
+    // move a short way, so this keeps the search and the refit above it local.
+    AABB newFat = bounds.Expanded(mMargin);
+    std::int32_t parent = mNodes[proxy].parent;
+    std::int32_t start = parent;
+    while (start != NULL_NODE && !mNodes[start].fat.Contains(newFat))
+    {
+        start = mNodes[start].parent;
+    }
+
+    std::int32_t replacement = RemoveLeaf(proxy);
+    if (start == parent)
+        start = replacement;
+
+    mNodes[proxy].fat = newFat;
+    InsertLeaf(proxy, start);
+    return true;
+}
+
+void AABBTree::Clear()
+{
+    mNodes.clear();
+    mBounds.clear();
+    mRoot = NULL_NODE;
+    mFreeList = NULL_NODE;
+    mProxyCount = 0;
+}
+
+void AABBTree::QueryNearest(const glm::vec3 &point, std::size_t k, std::vector<Entity> &out, NearestScratch &scratch) const
+{
+    out.clear();
+    if (mRoot == NULL_NODE || k == 0)
+        return;
+
+    // Best first search. Nodes are visited closest first, and the search stops once
+    // the closest unvisited node is further away than the k-th best proxy found so far.
+    // open is a min heap on distance, best a max heap holding the k closest proxies.
+    using Candidate = std::pair<float, std::int32_t>;
+    std::vector<Candidate> &open = scratch.open;
+    std::vector<Candidate> &best = scratch.best;
+    const std::greater<Candidate> closer;
+    open.clear();
+    best.clear();
+
+    open.push_back({mNodes[mRoot].fat.DistanceSquared(point), mRoot});
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), closer);
+        auto [distance, index] = open.back();
+        open.pop_back();
+        if (best.size() == k && distance > best.front().first)
+            break;
+
+        const Node &node = mNodes[index];
+        if (node.IsLeaf())
+        {
+            float leafDistance = mBounds[index].DistanceSquared(point);
+            if (best.size() == k)
+            {
+                if (leafDistance >= best.front().first)
+                    continue;
+                std::pop_heap(best.begin(), best.end());
+                best.pop_back();
+            }
+            best.push_back({leafDistance, index});
+            std::push_heap(best.begin(), best.end());
+            continue;
+        }
+
+        for (std::int32_t child : {node.child1, node.child2})
+        {
+            float childDistance = mNodes[child].fat.DistanceSquared(point);
+            if (best.size() < k || childDistance <= best.front().first)
+            {
+                open.push_back({childDistance, child});
+                std::push_heap(open.begin(), open.end(), closer);
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    out.resize(best.size());
+    for (std::size_t i = 0; i < best.size(); ++i)
+    {
+        out[i] = mNodes[best[i].second].entity;
+    }
+}
+
+std::int32_t AABBTree::AllocateNode()
+{
+    if (mFreeList == NULL_NODE)
+    {
+        mNodes.emplace_back();
+        mBounds.emplace_back();
+        return static_cast<std::int32_t>(mNodes.size() - 1);
+    }
+
+    std::int32_t index = mFreeList;
+    mFreeList = mNodes[index].parent;
+    mNodes[index] = Node();
+    return index;
+}
+
+void AABBTree::FreeNode(std::int32_t node)
+{
+    mNodes[node].parent = mFreeList;
+    mNodes[node].child1 = NULL_NODE;
+    mNodes[node].child2 = NULL_NODE;
+    mNodes[node].height = -1;
+    mNodes[node].entity = NULL_ENTITY;
+    mFreeList = node;
+}
+
+void AABBTree::InsertLeaf(std::int32_t leaf, std::int32_t start)
+{
+    if (mRoot == NULL_NODE)
+    {
+        mRoot = leaf;
+        mNodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that adds the least surface area. Every node on the way
+    // grows to include the leaf, which is the inherited cost of going one level deeper.
+    const AABB leafBox = mNodes[leaf].fat;
+    std::int32_t index = start == NULL_NODE ? mRoot : start;
+    while (!mNodes[index].IsLeaf())
+    {
+        const Node &node = mNodes[index];
+        float area = node.fat.SurfaceArea();
+        float combinedArea = AABB::Merge(node.fat, leafBox).SurfaceArea();
+
+        // Cost of pairing the leaf with this node, and of pushing it further down
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](std::int32_t child)
+        {
+            const Node &childNode = mNodes[child];
+            float mergedArea = AABB::Merge(childNode.fat, leafBox).SurfaceArea();
+            if (childNode.IsLeaf())
+                return mergedArea + inheritanceCost;
+            return mergedArea - childNode.fat.SurfaceArea() + inheritanceCost;
+        };
+
+        float cost1 = descendCost(node.child1);
+        float cost2 = descendCost(node.child2);
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    // Replace the sibling with a new parent of the sibling and the leaf
+    std::int32_t sibling = index;
+    std::int32_t newParent = AllocateNode();
+    std::int32_t oldParent = mNodes[sibling].parent;
+
+    Node &parentNode = mNodes[newParent];
+    parentNode.parent = oldParent;
+    parentNode.fat = AABB::Merge(leafBox, mNodes[sibling].fat);
+    parentNode.height = mNodes[sibling].height + 1;
+    parentNode.child1 = sibling;
+    parentNode.child2 = leaf;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (mNodes[oldParent].child1 == sibling)
+            mNodes[oldParent].child1 = newParent;
+        else
+            mNodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        mRoot = newParent;
+    }
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent = newParent;
+
+    FixUpwards(oldParent);
+}
+
+std::int32_t AABBTree::RemoveLeaf(std::int32_t leaf)
+{
+    if (leaf == mRoot)
+    {
+        mRoot = NULL_NODE;
+        return NULL_NODE;
+    }
+
+    // The sibling takes the place of the parent
+    std::int32_t parent = mNodes[leaf].parent;
+    std::int32_t grandParent = mNodes[parent].parent;
+    std::int32_t sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+    mNodes[sibling].parent = grandParent;
+    FreeNode(parent);
+
+    if (grandParent == NULL_NODE)
+    {
+        mRoot = sibling;
+        return sibling;
+    }
+
+    if (mNodes[grandParent].child1 == parent)
+        mNodes[grandParent].child1 = sibling;
+    else
+        mNodes[grandParent].child2 = sibling;
+
+    FixUpwards(grandParent);
+    return sibling;
+}
+
+void AABBTree::FixUpwards(std::int32_t index)
+{
+    while (index != NULL_NODE)
+    {
+        std::int32_t balanced = Balance(index);
+
+        Node &node = mNodes[balanced];
+        const Node &child1 = mNodes[node.child1];
+        const Node &child2 = mNodes[node.child2];
+        std::int32_t height = 1 + std::max(child1.height, child2.height);
+        AABB fat = AABB::Merge(child1.fat, child2.fat);
+
+        bool unchanged = balanced == index && height == node.height &&
+                         fat.min == node.fat.min && fat.max == node.fat.max;
+        node.height = height;
+        node.fat = fat;
+        if (unchanged)
+            return;
+
+        index = node.parent;
+    }
+}
+
+std::int32_t AABBTree::Balance(std::int32_t iA)
+{
+    Node &a = mNodes[iA];
+    if (a.IsLeaf() || a.height < 2)
+        return iA;
+
+    std::int32_t iB = a.child1;
+    std::int32_t iC = a.child2;
+    int balance = mNodes[iC].height - mNodes[iB].height;
+    if (balance >= -1 && balance <= 1)
+        return iA;
+
+    // Rotate the taller child up into A's place. Its taller child stays with it and its
+    // shorter child moves down to A, in place of the child that was rotated up.
+    bool rotateC = balance > 1;
+    std::int32_t iUp = rotateC ? iC : iB;
+    std::int32_t iKeep = rotateC ? iB : iC;
+    Node &up = mNodes[iUp];
+
+    std::int32_t iF = up.child1;
+    std::int32_t iG = up.child2;
+    std::int32_t iTall = mNodes[iF].height > mNodes[iG].height ? iF : iG;
+    std::int32_t iShort = iTall == iF ? iG : iF;
+
+    // Up takes A's place under A's parent
+    up.child1 = iA;
+    up.parent = a.parent;
+    a.parent = iUp;
+    if (up.parent != NULL_NODE)
+    {
+        if (mNodes[up.parent].child1 == iA)
+            mNodes[up.parent].child1 = iUp;
+        else
+            mNodes[up.parent].child2 = iUp;
+    }
+    else
+    {
+        mRoot = iUp;
+    }
+
+    up.child2 = iTall;
+    if (rotateC)
+        a.child2 = iShort;
+    else
+        a.child1 = iShort;
+    mNodes[iShort].parent = iA;
+
+    a.fat = AABB::Merge(mNodes[iKeep].fat, mNodes[iShort].fat);
+    a.height = 1 + std::max(mNodes[iKeep].height, mNodes[iShort].height);
+    up.fat = AABB::Merge(a.fat, mNodes[iTall].fat);
+    up.height = 1 + std::max(a.height, mNodes[iTall].height);
+    return iUp;
+}
+
+std::int32_t AABBTree::BuildTopDown(std::vector<std::int32_t> &leaves, std::size_t begin, std::size_t end)
+{
+    if (end - begin == 1)
+        return leaves[begin];
+
+    AABB centers = AABB::Empty();
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        centers.Grow(mNodes[leaves[i]].fat.Center());
+    }
+
+    glm::vec3 size = centers.max - centers.min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+    // Splitting at the median keeps the two halves within one level of each other
+    std::size_t middle = begin + (end - begin) / 2;
+    std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end,
+                     [this, axis](std::int32_t a, std::int32_t b)
+                     { return mNodes[a].fat.Center()[axis] < mNodes[b].fat.Center()[axis]; });
+
+    std::int32_t child1 = BuildTopDown(leaves, begin, middle);
+    std::int32_t child2 = BuildTopDown(leaves, middle, end);
+
+    std::int32_t index = AllocateNode();
+    Node &node = mNodes[index];
+    node.child1 = child1;
+    node.child2 = child2;
+    node.fat = AABB::Merge(mNodes[child1].fat, mNodes[child2].fat);
+    node.height = 1 + std::max(mNodes[child1].height, mNodes[child2].height);
+    mNodes[child1].parent = index;
+    mNodes[child2].parent = index;
+    return index;
+}
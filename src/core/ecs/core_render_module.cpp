@@ -1,7 +1,18 @@
 #include "core/ecs/core_render_module.hpp"
 #include "core/model.hpp"
 
-std::pair<std::string, std::string> CoreLightingModule::GetShaders(RenderSystem *renderSystem, Entity e) const
+namespace
+{
+  const Uniform<int> IGNORE_LIGHTING("ignoreLighting");
+
+  const Uniform<glm::vec3> MATERIAL_ALBEDO("materialAlbedo");
+  const Uniform<int> ALBEDO_MAP("albedoMap");
+  const Uniform<int> USE_ALBEDO_MAP("useAlbedoMap");
+
+  const Uniform<glm::mat4> MODEL("model");
+}
+
+std::pair<std::string_view, std::string_view> CoreLightingModule::GetShaders(RenderSystem *renderSystem, Entity e) const
 {
   if (!renderSystem->gCoordinator->HasComponent<MaterialComponent>(e))
   {
@@ -11,50 +22,48 @@ std::pair<std::string, std::string> CoreLightingModule::GetShaders(RenderSystem
   return {"", "shaders/basic_materials/default_shader.frag"};
 }
 
-void CoreLightingModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+void CoreLightingModule::GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const
 {
   if (!renderSystem->gCoordinator->HasComponent<MaterialComponent>(e))
   {
     return;
   }
-  glUniform3fv(glGetUniformLocation(program, "viewPos"), 1, glm::value_ptr(camera.Position));
-
-  // Lighting
-  // This if statement ignores lighting for all entities with a point light component
-  if (!renderSystem->gCoordinator->HasComponent<PointLightComponent>(e))
-  {
-    glUniform1i(glGetUniformLocation(program, "ignoreLighting"), false);
-
-    int lightCount = 0;
-    for (auto const &entityLight : renderSystem->mEntities)
-    {
-      if (!(renderSystem->gCoordinator->HasComponent<PointLightComponent>(entityLight) && renderSystem->gCoordinator->HasComponent<TransformComponent>(entityLight)))
-        continue;
-
-      auto &lightTransform = renderSystem->gCoordinator->GetComponent<TransformComponent>(entityLight);
-      auto &lightComponent = renderSystem->gCoordinator->GetComponent<PointLightComponent>(entityLight);
 
-      if (lightCount >= 64)
-        break;
-
-      std::string base = "pointLights[" + std::to_string(lightCount) + "]";
+  // Keyed by the first material, meshes with other materials still bind their own
+  const auto &materials = renderSystem->gCoordinator->GetComponent<MaterialComponent>(e).materials;
+  if (!materials.empty() && materials.front()->hasTexture())
+    hints.material = materials.front()->getTexture()->getID();
+}
 
-      glUniform3fv(glGetUniformLocation(program, (base + ".position").c_str()), 1, glm::value_ptr(lightTransform.translation));
-      glUniform3fv(glGetUniformLocation(program, (base + ".color").c_str()), 1, glm::value_ptr(lightComponent.color));
-      glUniform1f(glGetUniformLocation(program, (base + ".intensity").c_str()), lightComponent.intensity);
-      glUniform1f(glGetUniformLocation(program, (base + ".constant").c_str()), lightComponent.constant);
-      glUniform1f(glGetUniformLocation(program, (base + ".linear").c_str()), lightComponent.linear);
-      glUniform1f(glGetUniformLocation(program, (base + ".quadratic").c_str()), lightComponent.quadratic);
+bool CoreLightingModule::CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const
+{
+  bool firstHasMaterial = renderSystem->gCoordinator->HasComponent<MaterialComponent>(first);
+  if (firstHasMaterial != renderSystem->gCoordinator->HasComponent<MaterialComponent>(other))
+  {
+    return false;
+  }
+  if (!firstHasMaterial)
+  {
+    return true;
+  }
 
-      lightCount++;
-    }
+  // Same material objects, and both lit or both lights
+  return renderSystem->gCoordinator->GetComponent<MaterialComponent>(first).materials ==
+             renderSystem->gCoordinator->GetComponent<MaterialComponent>(other).materials &&
+         renderSystem->gCoordinator->HasComponent<PointLightComponent>(first) ==
+             renderSystem->gCoordinator->HasComponent<PointLightComponent>(other);
+}
 
-    glUniform1i(glGetUniformLocation(program, "numPointLights"), lightCount);
-  }
-  else
+void CoreLightingModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+{
+  if (!renderSystem->gCoordinator->HasComponent<MaterialComponent>(e))
   {
-    glUniform1i(glGetUniformLocation(program, "ignoreLighting"), true);
+    return;
   }
+  // Camera and lights come from the pass uniform blocks, see RenderSystem::UploadPassUniforms
+  // Lighting is ignored for all entities with a point light component
+  bool isLight = renderSystem->gCoordinator->HasComponent<PointLightComponent>(e);
+  IGNORE_LIGHTING.Set(renderSystem->GetUniforms(program), isLight);
 }
 
 void CoreLightingModule::UploadMeshUniforms(unsigned int program, RenderSystem *renderSystem, Entity e, int materialID)
@@ -93,23 +102,24 @@ void CoreLightingModule::UploadMeshUniforms(unsigned int program, RenderSystem *
       texture = material->getTexture();
   }
 
-  glUniform3fv(glGetUniformLocation(program, "materialAlbedo"), 1, glm::value_ptr(albedo));
+  const ProgramUniforms &uniforms = renderSystem->GetUniforms(program);
+  MATERIAL_ALBEDO.Set(uniforms, albedo);
 
   // Bind the texture
   if (texture)
   {
     unsigned int slot = 0; // Use slot 0 for base textures
-    texture->bind(slot);
-    glUniform1i(glGetUniformLocation(program, "albedoMap"), slot);
-    glUniform1i(glGetUniformLocation(program, "useAlbedoMap"), true);
+    renderSystem->BindTexture(slot, texture->getID());
+    ALBEDO_MAP.Set(uniforms, static_cast<int>(slot));
+    USE_ALBEDO_MAP.Set(uniforms, true);
   }
   else
   {
-    glUniform1i(glGetUniformLocation(program, "useAlbedoMap"), false);
+    USE_ALBEDO_MAP.Set(uniforms, false);
   }
 }
 
-std::pair<std::string, std::string> CoreObjectModule::GetShaders(RenderSystem *renderSystem, Entity e) const
+std::pair<std::string_view, std::string_view> CoreObjectModule::GetShaders(RenderSystem *renderSystem, Entity e) const
 {
   if (!renderSystem->gCoordinator->HasComponent<ModelComponent>(e))
   {
@@ -118,29 +128,46 @@ std::pair<std::string, std::string> CoreObjectModule::GetShaders(RenderSystem *r
   return {"shaders/basic_materials/default_shader.vert", ""};
 }
 
-void CoreObjectModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+void CoreObjectModule::GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const
 {
   if (!renderSystem->gCoordinator->HasComponent<ModelComponent>(e))
   {
     return;
   }
 
-  glm::mat4 view = camera.getViewMatrix();
-  glm::mat4 proj = camera.getProjectionMatrix(16.0f / 12.0f);
+  hints.mesh = RenderQueue::PointerKey(renderSystem->gCoordinator->GetComponent<ModelComponent>(e).model.get());
+}
+
+bool CoreObjectModule::CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const
+{
+  bool firstHasModel = renderSystem->gCoordinator->HasComponent<ModelComponent>(first);
+  if (firstHasModel != renderSystem->gCoordinator->HasComponent<ModelComponent>(other))
+  {
+    return false;
+  }
+
+  // The mesh sort hint is a hash, so compare the models themselves
+  return !firstHasModel || renderSystem->gCoordinator->GetComponent<ModelComponent>(first).model ==
+                               renderSystem->gCoordinator->GetComponent<ModelComponent>(other).model;
+}
 
-  glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-  glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+void CoreObjectModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+{
+  if (!renderSystem->gCoordinator->HasComponent<ModelComponent>(e))
+  {
+    return;
+  }
 
+  // View and projection come from the frame uniform block. Instanced programs take the
+  // model matrix per instance and have no model uniform, which leaves this a no-op.
+  const ProgramUniforms &uniforms = renderSystem->GetUniforms(program);
   if (!renderSystem->gCoordinator->HasComponent<TransformComponent>(e))
   {
-    glm::mat4 defaultModel(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(defaultModel));
+    MODEL.Set(uniforms, glm::mat4(1.0f));
     return;
   }
 
-  auto &transform = renderSystem->gCoordinator->GetComponent<TransformComponent>(e);
-  glm::mat4 model = transform.GetMatrix();
-  glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+  MODEL.Set(uniforms, renderSystem->GetModelMatrix(e));
 }
 
 void CoreObjectModule::DrawObject(unsigned int program, RenderSystem *renderSystem, Entity e)
@@ -156,6 +183,6 @@ void CoreObjectModule::DrawObject(unsigned int program, RenderSystem *renderSyst
     {
       module->UploadMeshUniforms(program, renderSystem, e, mesh->textureID);
     }
-    mesh->Draw();
+    renderSystem->DrawMesh(*mesh);
   }
 }
\ No newline at end of file
@@ -1,13 +1,45 @@
 #include "core/ecs/render_system.hpp"
 #include "core/material.hpp"
+#include "core/mesh.hpp"
 #include "core/model.hpp"
 #include <glad.h>
+#include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "core/texture.hpp"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
+namespace
+{
+    const Uniform<int> SCREEN_TEXTURE("screenTexture");
+    const Uniform<int> LIGHT_TEXELS("lightTexels");
+    const Uniform<int> CLUSTER_RANGES("clusterRanges");
+    const Uniform<int> CLUSTER_LIGHTS("clusterLights");
+
+    void CreateTextureBuffer(unsigned int &buffer, unsigned int &texture, GLenum format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_DYNAMIC_DRAW);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    }
+
+    // Re-specifies the whole buffer, so the driver can hand out fresh storage instead of
+    // waiting for the previous pass to finish reading it. Never empty, some drivers
+    // reject texture buffers without storage.
+    void UploadTextureBuffer(unsigned int buffer, const void *data, std::size_t size)
+    {
+        static const std::uint32_t empty[4] = {};
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size ? size : sizeof(empty), size ? data : empty, GL_DYNAMIC_DRAW);
+    }
+}
+
 std::string loadShaderSource(const char *filepath)
 {
     std::ifstream file(filepath);
@@ -39,10 +71,20 @@ unsigned int compileShader(const char *source, GLenum type)
     return shader;
 }
 
-unsigned int createShaderProgram(const char *vertexPath, const char *fragmentPath)
+// Defines go after the #version line, which has to come first
+void addShaderDefine(std::string &source, const char *name)
+{
+    std::size_t lineEnd = source.find('\n');
+    std::size_t position = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    source.insert(position, std::string("#define ") + name + "\n");
+}
+
+unsigned int createShaderProgram(const char *vertexPath, const char *fragmentPath, bool instanced)
 {
     std::string vSrc = loadShaderSource(vertexPath);
     std::string fSrc = loadShaderSource(fragmentPath);
+    if (instanced)
+        addShaderDefine(vSrc, "INSTANCED");
 
     unsigned int vShader = compileShader(vSrc.c_str(), GL_VERTEX_SHADER);
     unsigned int fShader = compileShader(fSrc.c_str(), GL_FRAGMENT_SHADER);
@@ -68,25 +110,96 @@ unsigned int createShaderProgram(const char *vertexPath, const char *fragmentPat
     return program;
 }
 
-unsigned int RenderSystem::GetOrCreateShader(const std::string &vert, const std::string &frag)
+unsigned int RenderSystem::GetOrCreateShader(std::string_view vert, std::string_view frag, bool instanced)
 {
-    ShaderKey key{vert, frag};
-    auto it = shaderCache.find(key);
+    mShaderLookup.vertex.assign(vert);
+    mShaderLookup.fragment.assign(frag);
+    mShaderLookup.instanced = instanced;
+    auto it = shaderCache.find(mShaderLookup);
     if (it != shaderCache.end())
         return it->second;
 
-    unsigned int program = createShaderProgram(vert.c_str(), frag.c_str());
-    shaderCache[key] = program;
+    unsigned int program = createShaderProgram(mShaderLookup.vertex.c_str(), mShaderLookup.fragment.c_str(), instanced);
+    shaderCache[mShaderLookup] = program;
+    mProgramKeys[program] = mShaderLookup;
+    mProgramUniforms[program].Reflect(program);
+    BindUniformBlock(program, "FrameData", FRAME_UNIFORM_BINDING);
+    BindUniformBlock(program, "LightData", LIGHT_UNIFORM_BINDING);
+
+    // The light buffers always sit on the same units, so the samplers are set once
+    GLint currentProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+    glUseProgram(program);
+    const ProgramUniforms &uniforms = GetUniforms(program);
+    LIGHT_TEXELS.Set(uniforms, LIGHT_TEXEL_UNIT);
+    CLUSTER_RANGES.Set(uniforms, CLUSTER_RANGE_UNIT);
+    CLUSTER_LIGHTS.Set(uniforms, CLUSTER_LIGHT_UNIT);
+    glUseProgram(currentProgram);
     return program;
 }
 
+unsigned int RenderSystem::GetInstancedProgram(unsigned int program)
+{
+    auto it = mInstancedPrograms.find(program);
+    if (it != mInstancedPrograms.end())
+        return it->second;
+
+    // Copied, GetOrCreateShader reuses the lookup key the stored one may be compared with
+    ShaderKey key = mProgramKeys.at(program);
+    unsigned int instancedProgram = GetOrCreateShader(key.vertex, key.fragment, true);
+    mInstancedPrograms.emplace(program, instancedProgram);
+    return instancedProgram;
+}
+
+const ProgramUniforms &RenderSystem::GetUniforms(unsigned int program)
+{
+    if (mLastUniforms && mLastUniformsProgram == program)
+        return *mLastUniforms;
+
+    auto it = mProgramUniforms.find(program);
+    if (it == mProgramUniforms.end())
+    {
+        // Linked somewhere else, reflect it on first use
+        it = mProgramUniforms.emplace(program, ProgramUniforms()).first;
+        it->second.Reflect(program);
+    }
+
+    mLastUniformsProgram = program;
+    mLastUniforms = &it->second;
+    return it->second;
+}
+
 void RenderSystem::Init(std::shared_ptr<Coordinator> coordinator, int screenWidth, int screenHeight)
 {
     this->screenWidth = screenWidth;
     this->screenHeight = screenHeight;
     gCoordinator = coordinator;
+
+    // Draw order comes from the render queue, entity order only breaks ties between equal keys
+    mEntities.SetSortedIteration(true);
+
+    // Issues GL calls, so it can only run on the thread owning the context
+    mMainThreadOnly = true;
+
+    // Lights are uploaded in entity order, so their texels keep the same place from frame to
+    // frame and a cluster past MAX_LIGHTS_PER_CLUSTER always keeps the same lights
+    pointLights.SetSortedIteration(true);
+    coordinator->View<PointLightComponent>().Each([this](Entity entity, PointLightComponent &)
+                                                  { pointLights.Insert(entity); });
+    coordinator->OnAdd<PointLightComponent>([this](Entity entity, PointLightComponent &)
+                                            { pointLights.Insert(entity); });
+    coordinator->OnRemove<PointLightComponent>([this](Entity entity, PointLightComponent &)
+                                               { pointLights.Erase(entity); });
+
+    mBoundTextures.fill(UNKNOWN_TEXTURE);
+
     glEnable(GL_CLIP_DISTANCE0);
     InitPostProcessing();
+    InitUniformBuffers();
+
+    glGenBuffers(1, &instanceVBO);
+
+    mFrameStartAllocations = GetHeapAllocationCount();
 }
 
 void RenderSystem::InitPostProcessing()
@@ -154,6 +267,108 @@ void RenderSystem::InitPostProcessing()
     glBindVertexArray(0);
 }
 
+void RenderSystem::InitUniformBuffers()
+{
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameUBO);
+
+    glGenBuffers(1, &lightUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, lightUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_UNIFORM_BINDING, lightUBO);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    CreateTextureBuffer(lightTexelBuffer, lightTexelTex, GL_RGBA32F);
+    CreateTextureBuffer(clusterRangeBuffer, clusterRangeTex, GL_RG32UI);
+    CreateTextureBuffer(clusterLightBuffer, clusterLightTex, GL_R32UI);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &mMaxTextureBufferSize);
+}
+
+void RenderSystem::UploadPassUniforms(const Camera &camera, bool useClippingPlane, glm::vec4 clippingPlane)
+{
+    FrameUniforms frame{};
+    frame.view = camera.getViewMatrix();
+    frame.projection = camera.getProjectionMatrix(16.0f / 12.0f);
+    frame.clipPlane = clippingPlane;
+    frame.viewPos = camera.Position;
+    frame.time = static_cast<float>(glfwGetTime());
+    frame.enableClip = useClippingPlane ? GL_TRUE : GL_FALSE;
+
+    // Re-specifying the whole buffer lets the driver hand out fresh storage instead of
+    // waiting for the previous pass to finish reading it
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &frame, GL_DYNAMIC_DRAW);
+
+    // Three texels per light, so the light count is bounded by the texture buffer size
+    const std::size_t maxLights = static_cast<std::size_t>(mMaxTextureBufferSize) / 3;
+
+    mClusterLights.clear();
+    mLightTexels.clear();
+    for (auto const &entityLight : pointLights)
+    {
+        if (mClusterLights.size() >= maxLights)
+            break;
+        if (!gCoordinator->HasComponent<TransformComponent>(entityLight))
+            continue;
+
+        auto &light = gCoordinator->GetComponent<PointLightComponent>(entityLight);
+        glm::vec3 position = glm::vec3(GetModelMatrix(entityLight)[3]);
+        float brightness = light.intensity * std::max(light.color.x, std::max(light.color.y, light.color.z));
+        float radius = LightInfluenceRadius(brightness, light.constant, light.linear, light.quadratic);
+        if (radius <= 0.0f)
+            continue;
+
+        mClusterLights.push_back({glm::vec3(frame.view * glm::vec4(position, 1.0f)), radius});
+        mLightTexels.push_back(glm::vec4(position, light.intensity));
+        mLightTexels.push_back(glm::vec4(light.color, light.constant));
+        mLightTexels.push_back(glm::vec4(light.linear, light.quadratic, radius, 0.0f));
+    }
+
+    // Matches Camera::getProjectionMatrix
+    mLightClusters.SetFrustum(glm::radians(camera.Zoom), 16.0f / 12.0f, 0.01f, 1000.0f);
+    mLightClusters.Assign(mClusterLights.data(), mClusterLights.size(), mJobSystem);
+
+    // Clusters whose lights would run past the end of the index buffer lose them
+    const std::vector<std::uint32_t> &indices = mLightClusters.LightIndices();
+    const std::uint32_t maxIndices = static_cast<std::uint32_t>(mMaxTextureBufferSize);
+    mClusterRanges = mLightClusters.Ranges();
+    for (std::size_t i = 0; indices.size() > maxIndices && i < mClusterRanges.size(); i += 2)
+    {
+        std::uint32_t first = mClusterRanges[i];
+        mClusterRanges[i + 1] = first >= maxIndices ? 0 : std::min(mClusterRanges[i + 1], maxIndices - first);
+    }
+
+    UploadTextureBuffer(lightTexelBuffer, mLightTexels.data(), mLightTexels.size() * sizeof(glm::vec4));
+    UploadTextureBuffer(clusterRangeBuffer, mClusterRanges.data(), mClusterRanges.size() * sizeof(std::uint32_t));
+    UploadTextureBuffer(clusterLightBuffer, indices.data(), std::min<std::size_t>(indices.size(), maxIndices) * sizeof(std::uint32_t));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    LightUniforms lights{};
+    lights.clusterGrid[0] = LightClusters::TILES_X;
+    lights.clusterGrid[1] = LightClusters::TILES_Y;
+    lights.clusterGrid[2] = LightClusters::DEPTH_SLICES;
+    lights.clusterGrid[3] = static_cast<std::uint32_t>(mClusterLights.size());
+    lights.clusterDepth = glm::vec4(LightClusters::FIRST_SLICE_DEPTH, mLightClusters.SliceScale(), 0.0f, 0.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, lightUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightUniforms), &lights, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE0 + LIGHT_TEXEL_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexelTex);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_RANGE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, clusterRangeTex);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHT_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, clusterLightTex);
+    glActiveTexture(GL_TEXTURE0);
+}
+
 void RenderSystem::AddModule(std::unique_ptr<RenderModule> module)
 {
     for (const auto &m : modules)
@@ -208,13 +423,20 @@ void RenderSystem::Update(float deltaTime, const Camera &camera)
     glUseProgram(finalShader);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, inputTex);
-    glUniform1i(glGetUniformLocation(finalShader, "screenTexture"), 0);
+    SCREEN_TEXTURE.Set(GetUniforms(finalShader), 0);
 
     glBindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 
     glEnable(GL_DEPTH_TEST);
+
+    // Frame scoped data is done with once the frame is rendered
+    GetFrameArena().Reset();
+
+    std::uint64_t allocations = GetHeapAllocationCount();
+    frameHeapAllocations = allocations - mFrameStartAllocations;
+    mFrameStartAllocations = allocations;
 }
 
 unsigned int RenderSystem::DoPostProcessPass(std::unique_ptr<PostProcessPass> &pass, unsigned int inputTex, int &passIndex)
@@ -234,7 +456,7 @@ unsigned int RenderSystem::DoPostProcessPass(std::unique_ptr<PostProcessPass> &p
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glUniform1i(glGetUniformLocation(shader, "screenTexture"), 0);
+    SCREEN_TEXTURE.Set(GetUniforms(shader), 0);
 
     glBindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -245,12 +467,65 @@ unsigned int RenderSystem::DoPostProcessPass(std::unique_ptr<PostProcessPass> &p
     return returnImage;
 }
 
+glm::mat4 RenderSystem::GetModelMatrix(Entity entity) const
+{
+    if (gCoordinator->HasComponent<WorldMatrixComponent>(entity))
+        return gCoordinator->GetComponent<WorldMatrixComponent>(entity).matrix;
+
+    return gCoordinator->GetComponent<TransformComponent>(entity).GetMatrix();
+}
+
+void RenderSystem::BindTexture(unsigned int slot, unsigned int texture)
+{
+    if (texture == 0)
+        return;
+
+    if (slot < mBoundTextures.size())
+    {
+        if (mBoundTextures[slot] == texture)
+            return;
+        mBoundTextures[slot] = texture;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RenderSystem::DrawMesh(const Mesh &mesh)
+{
+    if (mInstanceCount > 1)
+        mesh.DrawInstanced(mInstanceCount, instanceVBO, mInstanceOffset);
+    else
+        mesh.Draw();
+}
+
+bool RenderSystem::CanInstance(const DrawItem &first, const DrawItem &other, bool mainRender)
+{
+    if (other.program != first.program || !RenderQueue::SameState(first.key, other.key))
+        return false;
+
+    for (auto &module : modules)
+    {
+        if (!mainRender && module->requiresOffscreenFrameBuffer)
+        {
+            continue;
+        }
+        if (!module->CanInstance(this, first.entity, other.entity))
+            return false;
+    }
+    return true;
+}
+
 void RenderSystem::RenderScene(float deltaTime, const Camera &camera, bool mainRender, bool useClippingPlane, glm::vec4 clippingPlane)
 {
+    // Matches the far plane of Camera::getProjectionMatrix
+    const float sortDepthRange = 1000.0f;
 
+    mRenderQueue.Clear();
     for (auto const &entity : mEntities)
     {
-        std::string vertexPath, fragmentPath;
+        std::string_view vertexPath, fragmentPath;
+        DrawSortHints hints;
 
         for (auto &module : modules)
         {
@@ -263,6 +538,7 @@ void RenderSystem::RenderScene(float deltaTime, const Camera &camera, bool mainR
                 vertexPath = vert;
             if (!frag.empty())
                 fragmentPath = frag;
+            module->GetSortHints(this, entity, hints);
         }
 
         if (vertexPath.empty() || fragmentPath.empty())
@@ -271,16 +547,60 @@ void RenderSystem::RenderScene(float deltaTime, const Camera &camera, bool mainR
         }
 
         unsigned int program = GetOrCreateShader(vertexPath, fragmentPath);
-        glUseProgram(program);
+        glm::vec3 toEntity = glm::vec3(GetModelMatrix(entity)[3]) - camera.Position;
+        float depth = glm::dot(toEntity, camera.Front) / sortDepthRange;
+        mRenderQueue.Push(RenderQueue::MakeKey(hints, program, depth), entity, program);
+    }
+
+    mRenderQueue.Sort();
 
-        if (useClippingPlane)
+    // Sorting put draws sharing state next to each other, runs the modules agree on become
+    // one instanced draw
+    mBatches.clear();
+    mInstanceMatrices.clear();
+    const std::uint32_t itemCount = static_cast<std::uint32_t>(mRenderQueue.Size());
+    for (std::uint32_t first = 0; first < itemCount;)
+    {
+        std::uint32_t end = first + 1;
+        while (end < itemCount && CanInstance(mRenderQueue[first], mRenderQueue[end], mainRender))
+            ++end;
+
+        DrawBatch batch{first, end - first, static_cast<std::uint32_t>(mInstanceMatrices.size())};
+        if (batch.count > 1)
         {
-            glUniform1i(glGetUniformLocation(program, "enableClip"), GL_TRUE);
-            glUniform4f(glGetUniformLocation(program, "clipPlane"), clippingPlane.x, clippingPlane.y, clippingPlane.z, clippingPlane.w);
+            for (std::uint32_t i = first; i < end; ++i)
+                mInstanceMatrices.push_back(GetModelMatrix(mRenderQueue[i].entity));
         }
-        else
+        mBatches.push_back(batch);
+        first = end;
+    }
+
+    if (!mInstanceMatrices.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, mInstanceMatrices.size() * sizeof(glm::mat4), mInstanceMatrices.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    UploadPassUniforms(camera, useClippingPlane, clippingPlane);
+
+    // Nothing is known to be bound yet, textures may have been bound outside the scene
+    mBoundTextures.fill(UNKNOWN_TEXTURE);
+
+    unsigned int currentProgram = 0;
+    for (const DrawBatch &batch : mBatches)
+    {
+        // The first entity of a batch stands in for all of them, only its matrix differs
+        const DrawItem &item = mRenderQueue[batch.first];
+        Entity entity = item.entity;
+        unsigned int program = batch.count > 1 ? GetInstancedProgram(item.program) : item.program;
+        mInstanceCount = static_cast<GLsizei>(batch.count);
+        mInstanceOffset = batch.firstInstance * sizeof(glm::mat4);
+
+        if (program != currentProgram)
         {
-            glUniform1i(glGetUniformLocation(program, "enableClip"), GL_FALSE);
+            currentProgram = program;
+            glUseProgram(currentProgram);
         }
 
         for (auto &module : modules)
@@ -289,7 +609,7 @@ void RenderSystem::RenderScene(float deltaTime, const Camera &camera, bool mainR
             {
                 continue;
             }
-            module->UploadObjectUniforms(program, this, camera, entity);
+            module->UploadObjectUniforms(currentProgram, this, camera, entity);
         }
 
         for (auto &module : modules)
@@ -298,16 +618,21 @@ void RenderSystem::RenderScene(float deltaTime, const Camera &camera, bool mainR
             {
                 continue;
             }
-            module->DrawObject(program, this, entity);
+            module->DrawObject(currentProgram, this, entity);
         }
+    }
+    mInstanceCount = 1;
+    mInstanceOffset = 0;
 
-        int maxUnits = 0;
-        glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnits);
-        for (int i = 0; i < maxUnits; ++i)
-        {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
-        glActiveTexture(GL_TEXTURE0);
+    // Leave no scene texture bound for the passes that follow
+    for (unsigned int i = 0; i < mBoundTextures.size(); ++i)
+    {
+        if (mBoundTextures[i] == UNKNOWN_TEXTURE)
+            continue;
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        mBoundTextures[i] = UNKNOWN_TEXTURE;
     }
-}
\ No newline at end of file
+    glActiveTexture(GL_TEXTURE0);
+}
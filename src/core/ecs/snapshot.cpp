@@ -0,0 +1,90 @@
+#include "core/ecs/snapshot.hpp"
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VERTEX_HAS_MMAP 1
+#endif
+
+MappedFile::~MappedFile()
+{
+#ifdef VERTEX_HAS_MMAP
+    if (mMapped)
+        munmap(const_cast<char *>(mData), mSize);
+#endif
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+#ifdef VERTEX_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        std::cerr << "Failed to read file size: " << path << std::endl;
+        return false;
+    }
+
+    mSize = static_cast<std::size_t>(info.st_size);
+    if (mSize == 0)
+    {
+        // mmap rejects empty ranges, an empty file is just an empty view
+        close(fd);
+        return true;
+    }
+
+    void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        mSize = 0;
+        std::cerr << "Failed to map file: " << path << std::endl;
+        return false;
+    }
+
+    mData = static_cast<const char *>(data);
+    mMapped = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    mFallback.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(mFallback.data(), mFallback.size()))
+    {
+        std::cerr << "Failed to read file: " << path << std::endl;
+        return false;
+    }
+
+    mData = mFallback.data();
+    mSize = mFallback.size();
+    return true;
+#endif
+}
+
+bool WriteFile(const std::string &path, const std::vector<char> &buffer)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(buffer.data(), buffer.size()))
+    {
+        std::cerr << "Failed to write file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#include "core/ecs/spatial_index_system.hpp"
+#include "core/model.hpp"
+
+void SpatialIndexSystem::Init(std::shared_ptr<Coordinator> coordinator, float margin)
+{
+    gCoordinator = coordinator;
+    mTree = AABBTree(margin);
+
+    // Removals leave no change tick behind, so they are caught here instead
+    coordinator->OnRemove<TransformComponent>([this](Entity entity, TransformComponent &)
+                                              { RemoveProxy(entity); });
+    coordinator->OnRemove<ModelComponent>([this](Entity entity, ModelComponent &)
+                                          { mDirty.push_back(entity); });
+    coordinator->OnRemove<BoundsComponent>([this](Entity entity, BoundsComponent &)
+                                           { mDirty.push_back(entity); });
+}
+
+void SpatialIndexSystem::Update()
+{
+    ChangeTick since = mLastTick;
+    mLastTick = gCoordinator->GetChangeTick();
+
+    // New entities count as changed, so this also inserts them
+    auto refit = [this](Entity entity, auto &)
+    {
+        Refit(entity);
+    };
+    gCoordinator->View<TransformComponent>().EachChangedSince<TransformComponent>(since, refit);
+    gCoordinator->View<WorldMatrixComponent>().EachChangedSince<WorldMatrixComponent>(since, refit);
+    gCoordinator->View<ModelComponent>().EachChangedSince<ModelComponent>(since, refit);
+    gCoordinator->View<BoundsComponent>().EachChangedSince<BoundsComponent>(since, refit);
+
+    for (Entity entity : mDirty)
+    {
+        Refit(entity);
+    }
+    mDirty.clear();
+
+    // Many new entities at once, e.g. a loaded level, are cheaper to index by rebuilding
+    // the tree top down than by inserting them one at a time
+    std::size_t pending = mPendingEntities.size();
+    if (pending > 256 && pending > mTree.GetProxyCount() / 8)
+    {
+        std::vector<std::int32_t> proxies(pending);
+        mTree.CreateProxies(mPendingBounds.data(), mPendingEntities.data(), pending, proxies.data());
+        for (std::size_t i = 0; i < pending; ++i)
+        {
+            mProxies[EntityIndex(mPendingEntities[i])] = proxies[i];
+        }
+    }
+    else
+    {
+        for (std::size_t i = 0; i < pending; ++i)
+        {
+            mProxies[EntityIndex(mPendingEntities[i])] = mTree.CreateProxy(mPendingBounds[i], mPendingEntities[i]);
+        }
+    }
+    mPendingBounds.clear();
+    mPendingEntities.clear();
+}
+
+AABB SpatialIndexSystem::ComputeWorldBounds(Entity entity) const
+{
+    AABB local;
+    if (gCoordinator->HasComponent<BoundsComponent>(entity))
+    {
+        local = gCoordinator->GetComponent<BoundsComponent>(entity).bounds;
+    }
+    else if (gCoordinator->HasComponent<ModelComponent>(entity))
+    {
+        const auto &model = gCoordinator->GetComponent<ModelComponent>(entity).model;
+        if (model && !model->bounds.IsEmpty())
+            local = model->bounds;
+    }
+
+    if (gCoordinator->HasComponent<WorldMatrixComponent>(entity))
+        return local.Transformed(gCoordinator->GetComponent<WorldMatrixComponent>(entity).matrix);
+
+    return local.Transformed(gCoordinator->GetComponent<TransformComponent>(entity).GetMatrix());
+}
+
+void SpatialIndexSystem::Refit(Entity entity)
+{
+    // Changes to entities without a transform, or already destroyed, are not indexed
+    if (!gCoordinator->IsAlive(entity) || !gCoordinator->HasComponent<TransformComponent>(entity))
+        return;
+
+    Entity index = EntityIndex(entity);
+    if (index >= mProxies.size())
+        mProxies.resize(index + 1, AABBTree::NULL_NODE);
+
+    std::int32_t &proxy = mProxies[index];
+    if (proxy == PENDING_PROXY)
+        return;
+
+    if (proxy != AABBTree::NULL_NODE && mTree.GetEntity(proxy) != entity)
+    {
+        // The slot was reused by a new entity since the proxy was created
+        mTree.DestroyProxy(proxy);
+        proxy = AABBTree::NULL_NODE;
+    }
+
+    if (proxy == AABBTree::NULL_NODE)
+    {
+        // Bounds are final for this update, so the entity is queued only once
+        mPendingBounds.push_back(ComputeWorldBounds(entity));
+        mPendingEntities.push_back(entity);
+        proxy = PENDING_PROXY;
+        return;
+    }
+
+    mTree.MoveProxy(proxy, ComputeWorldBounds(entity));
+}
+
+void SpatialIndexSystem::RemoveProxy(Entity entity)
+{
+    Entity index = EntityIndex(entity);
+    if (index >= mProxies.size() || mProxies[index] < 0)
+        return;
+
+    if (mTree.GetEntity(mProxies[index]) == entity)
+    {
+        mTree.DestroyProxy(mProxies[index]);
+        mProxies[index] = AABBTree::NULL_NODE;
+    }
+}
@@ -0,0 +1,158 @@
+#include "core/ecs/transform_system.hpp"
+#include <algorithm>
+#include <functional>
+
+void TransformSystem::Init(std::shared_ptr<Coordinator> coordinator)
+{
+    gCoordinator = coordinator;
+}
+
+void TransformSystem::Update()
+{
+    ChangeTick since = mLastTick;
+    mLastTick = gCoordinator->GetChangeTick();
+
+    // Membership or parenting changes invalidate the depth order. A removed hierarchy
+    // component leaves no tick behind, so the component count is compared as well.
+    auto hierarchies = gCoordinator->View<HierarchyComponent>();
+    bool rebuild = !mOrderBuilt || mEntities.Revision() != mOrderRevision || hierarchies.SizeHint() != mHierarchyCount;
+    if (!rebuild)
+    {
+        hierarchies.EachChangedSince<HierarchyComponent>(since, [&rebuild](Entity, HierarchyComponent &)
+                                                         { rebuild = true; });
+    }
+
+    if (rebuild)
+    {
+        RebuildOrder();
+        mOrderBuilt = true;
+        mOrderRevision = mEntities.Revision();
+        mHierarchyCount = hierarchies.SizeHint();
+    }
+
+    auto components = View();
+    auto updateRange = [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            Entity entity = mOrder[i];
+            std::uint32_t parent = mParents[i];
+
+            bool parentUpdated = parent != NO_PARENT && mUpdated[parent];
+            if (!rebuild && !parentUpdated && !components.ChangedSince<TransformComponent>(entity, since))
+            {
+                mUpdated[i] = 0;
+                continue;
+            }
+
+            glm::mat4 local = components.Get<TransformComponent>(entity).GetMatrix();
+            glm::mat4 &world = components.Patch<WorldMatrixComponent>(entity).matrix;
+            if (parent == NO_PARENT)
+                world = local;
+            else
+                world = components.Get<WorldMatrixComponent>(mOrder[parent]).matrix * local;
+
+            mUpdated[i] = 1;
+        }
+    };
+
+    // Every parent sits in an earlier level, so it is final before its level starts.
+    // Levels too small to split run inline, which keeps deep chains free of job overhead.
+    const std::size_t grainSize = 1024;
+    const std::function<void(std::size_t, std::size_t)> updateJob = updateRange;
+    JobSystem &jobSystem = gCoordinator->GetJobSystem();
+    for (std::size_t level = 0; level + 1 < mLevelStarts.size(); ++level)
+    {
+        std::size_t begin = mLevelStarts[level];
+        std::size_t end = mLevelStarts[level + 1];
+        if (end - begin <= grainSize)
+            updateRange(begin, end);
+        else
+            jobSystem.ParallelFor(begin, end, grainSize, updateJob);
+    }
+}
+
+void TransformSystem::RebuildOrder()
+{
+    const std::uint32_t UNKNOWN = ~std::uint32_t(0);
+    const std::uint32_t VISITING = UNKNOWN - 1;
+
+    std::size_t slotCount = 0;
+    for (Entity entity : mEntities)
+    {
+        slotCount = std::max<std::size_t>(slotCount, EntityIndex(entity) + 1);
+    }
+
+    // Depth and effective parent of every member, indexed by entity slot
+    std::vector<std::uint32_t> depths(slotCount, UNKNOWN);
+    std::vector<Entity> parents(slotCount, NULL_ENTITY);
+
+    auto parentOf = [this](Entity entity)
+    {
+        if (!gCoordinator->HasComponent<HierarchyComponent>(entity))
+            return NULL_ENTITY;
+
+        // A parent that is gone or has no world matrix of its own leaves the entity a root
+        Entity parent = gCoordinator->GetComponent<HierarchyComponent>(entity).parent;
+        return parent != NULL_ENTITY && mEntities.Contains(parent) ? parent : NULL_ENTITY;
+    };
+
+    std::vector<std::size_t> levelCounts;
+    std::vector<Entity> chain;
+    for (Entity entity : mEntities)
+    {
+        // Climb until reaching a root or an entity whose depth is already known,
+        // then assign depths on the way back down
+        chain.clear();
+        Entity current = entity;
+        while (current != NULL_ENTITY && depths[EntityIndex(current)] == UNKNOWN)
+        {
+            depths[EntityIndex(current)] = VISITING;
+            chain.push_back(current);
+
+            Entity parent = parentOf(current);
+            if (parent != NULL_ENTITY && depths[EntityIndex(parent)] == VISITING)
+            {
+                // Parent cycle, cut it by making this entity a root
+                parent = NULL_ENTITY;
+            }
+            parents[EntityIndex(current)] = parent;
+            current = parent;
+        }
+
+        std::uint32_t depth = current == NULL_ENTITY ? 0 : depths[EntityIndex(current)] + 1;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it, ++depth)
+        {
+            depths[EntityIndex(*it)] = depth;
+            if (depth >= levelCounts.size())
+                levelCounts.resize(depth + 1, 0);
+            ++levelCounts[depth];
+        }
+    }
+
+    // Counting sort by depth
+    mLevelStarts.assign(levelCounts.size() + 1, 0);
+    for (std::size_t level = 0; level < levelCounts.size(); ++level)
+    {
+        mLevelStarts[level + 1] = mLevelStarts[level] + levelCounts[level];
+    }
+
+    std::vector<std::size_t> next(mLevelStarts.begin(), mLevelStarts.end() - 1);
+    std::vector<std::uint32_t> positions(slotCount, NO_PARENT);
+    mOrder.resize(mEntities.Size());
+    for (Entity entity : mEntities)
+    {
+        std::size_t position = next[depths[EntityIndex(entity)]]++;
+        mOrder[position] = entity;
+        positions[EntityIndex(entity)] = static_cast<std::uint32_t>(position);
+    }
+
+    mParents.resize(mOrder.size());
+    for (std::size_t i = 0; i < mOrder.size(); ++i)
+    {
+        Entity parent = parents[EntityIndex(mOrder[i])];
+        mParents[i] = parent == NULL_ENTITY ? NO_PARENT : positions[EntityIndex(parent)];
+    }
+
+    mUpdated.assign(mOrder.size(), 0);
+}
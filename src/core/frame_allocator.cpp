@@ -0,0 +1,182 @@
+#include "core/frame_allocator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<std::uint64_t> gHeapAllocations{0};
+}
+
+FrameArena::FrameArena(std::size_t blockSize) : mBlockSize(blockSize)
+{
+    AddBlock(mBlockSize);
+}
+
+FrameArena::~FrameArena()
+{
+    for (Block &block : mBlocks)
+    {
+        ::operator delete(block.data);
+    }
+}
+
+void *FrameArena::Allocate(std::size_t size, std::size_t alignment)
+{
+    while (true)
+    {
+        Block &block = mBlocks[mCurrent];
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.data) + mOffset;
+        std::size_t padding = (alignment - address % alignment) % alignment;
+        if (mOffset + padding + size <= block.size)
+        {
+            mOffset += padding + size;
+            mUsed += padding + size;
+            return block.data + mOffset - size;
+        }
+
+        // Move on to the next block, growing the arena when there is none left
+        if (mCurrent + 1 == mBlocks.size())
+            AddBlock(std::max(mBlockSize, size + alignment));
+        ++mCurrent;
+        mOffset = 0;
+    }
+}
+
+void FrameArena::Reset()
+{
+    if (mBlocks.size() > 1)
+    {
+        std::size_t capacity = Capacity();
+        for (Block &block : mBlocks)
+        {
+            ::operator delete(block.data);
+        }
+        mBlocks.clear();
+        AddBlock(capacity);
+    }
+
+    mCurrent = 0;
+    mOffset = 0;
+    mUsed = 0;
+}
+
+std::size_t FrameArena::Capacity() const
+{
+    std::size_t capacity = 0;
+    for (const Block &block : mBlocks)
+    {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+void FrameArena::AddBlock(std::size_t size)
+{
+    mBlocks.push_back({static_cast<char *>(::operator new(size)), size});
+}
+
+FrameArena &GetFrameArena()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+FrameString FrameFormat(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list sizeArgs;
+    va_copy(sizeArgs, args);
+    int length = std::vsnprintf(nullptr, 0, format, sizeArgs);
+    va_end(sizeArgs);
+
+    FrameString result;
+    if (length > 0)
+    {
+        result.resize(static_cast<std::size_t>(length));
+        std::vsnprintf(&result[0], result.size() + 1, format, args);
+    }
+    va_end(args);
+    return result;
+}
+
+std::uint64_t GetHeapAllocationCount()
+{
+    return gHeapAllocations.load(std::memory_order_relaxed);
+}
+
+// Replacements of the global allocation functions, only to count calls. Aligned
+// variants are left to the standard library, they rarely show up in frame code.
+void *operator new(std::size_t size)
+{
+    gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+
+    while (true)
+    {
+        if (void *memory = std::malloc(size))
+            return memory;
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return ::operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
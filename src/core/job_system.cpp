@@ -0,0 +1,223 @@
+#include "core/job_system.hpp"
+#include <algorithm>
+
+namespace
+{
+    // Which pool and queue the current thread works on, unset outside worker threads
+    thread_local const JobSystem *tJobSystem = nullptr;
+    thread_local unsigned int tQueueIndex = 0;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    for (unsigned int i = 0; i <= workerCount; ++i)
+    {
+        mQueues.push_back(std::make_unique<JobQueue>());
+    }
+
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        mWorkers.emplace_back([this, i]()
+                              { WorkerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+
+    for (auto &worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::Submit(std::function<void()> task, JobCounter *counter)
+{
+    if (counter)
+    {
+        counter->mPending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Push({std::move(task), counter});
+}
+
+void JobSystem::SubmitAfter(JobCounter &dependency, std::function<void()> task, JobCounter *counter)
+{
+    if (counter)
+    {
+        counter->mPending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        // Run() drops the count to zero under the same lock, so either the continuation
+        // is parked before that and gets submitted by Run(), or the dependency is already done
+        std::lock_guard<std::mutex> lock(dependency.mMutex);
+        if (!dependency.IsDone())
+        {
+            dependency.mContinuations.push_back({std::move(task), counter});
+            return;
+        }
+    }
+
+    Push({std::move(task), counter});
+}
+
+void JobSystem::Wait(JobCounter &counter)
+{
+    while (!counter.IsDone())
+    {
+        if (!TryRunOne())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job drops the count to zero while holding the lock, so once we can take it
+    // that job is done with the counter and the caller is free to destroy it
+    std::lock_guard<std::mutex> lock(counter.mMutex);
+}
+
+bool JobSystem::TryRunOne()
+{
+    Job job;
+    if (!Pop(job))
+        return false;
+
+    Run(job);
+    return true;
+}
+
+void JobSystem::ParallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)> &func)
+{
+    if (begin >= end)
+        return;
+
+    grainSize = std::max<std::size_t>(grainSize, 1);
+
+    // Not worth the submission cost when it all fits in one chunk
+    if (end - begin <= grainSize)
+    {
+        func(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize)
+    {
+        std::size_t chunkEnd = std::min(chunkBegin + grainSize, end);
+        Submit([&func, chunkBegin, chunkEnd]()
+               { func(chunkBegin, chunkEnd); },
+               &counter);
+    }
+    Wait(counter);
+}
+
+void JobSystem::Push(Job job)
+{
+    unsigned int index = tJobSystem == this ? tQueueIndex : static_cast<unsigned int>(mQueues.size() - 1);
+    {
+        std::lock_guard<std::mutex> lock(mQueues[index]->mutex);
+        mQueues[index]->jobs.push_back(std::move(job));
+    }
+
+    mQueuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the lock orders this with a worker checking mQueuedJobs before it sleeps
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+    mWake.notify_one();
+}
+
+bool JobSystem::Pop(Job &job)
+{
+    if (mQueuedJobs.load(std::memory_order_acquire) <= 0)
+        return false;
+
+    const unsigned int queueCount = static_cast<unsigned int>(mQueues.size());
+    const unsigned int own = tJobSystem == this ? tQueueIndex : queueCount - 1;
+
+    // Newest job from our own queue first, it is the most likely to be warm in cache
+    {
+        JobQueue &queue = *mQueues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Otherwise steal the oldest job of another queue
+    for (unsigned int offset = 1; offset < queueCount; ++offset)
+    {
+        JobQueue &queue = *mQueues[(own + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::Run(Job &job)
+{
+    job.task();
+
+    JobCounter *counter = job.counter;
+    if (!counter)
+        return;
+
+    // Jobs that are clearly not the last of their group only need the atomic decrement
+    int pending = counter->mPending.load(std::memory_order_relaxed);
+    while (pending > 1)
+    {
+        if (counter->mPending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+            return;
+    }
+
+    // Possibly the last one: decrement under the lock so SubmitAfter and Wait see a consistent state
+    std::vector<JobCounter::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->mMutex);
+        if (counter->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->mContinuations);
+    }
+
+    for (auto &continuation : continuations)
+    {
+        Push({std::move(continuation.task), continuation.counter});
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+    tJobSystem = this;
+    tQueueIndex = index;
+
+    while (true)
+    {
+        Job job;
+        if (Pop(job))
+        {
+            Run(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWake.wait(lock, [this]()
+                   { return mStopping || mQueuedJobs.load(std::memory_order_acquire) > 0; });
+        if (mStopping)
+            return;
+    }
+}
@@ -0,0 +1,251 @@
+#include "core/light_clusters.hpp"
+#include "core/job_system.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const std::uint32_t TILES_PER_SLICE = LightClusters::TILES_X * LightClusters::TILES_Y;
+    const std::uint32_t PAIR_LIGHT_MASK = (1u << 24) - 1;
+
+    // Fewer lights than this are assigned on the calling thread, the slices are too cheap
+    // to pay for a job each and every submitted job allocates
+    const std::size_t PARALLEL_LIGHT_COUNT = 256;
+
+    // Depth slices per job above it, six jobs over the 24 slices
+    const std::size_t SLICES_PER_JOB = 4;
+
+    // First and last tile a range of normalized device coordinates covers, first > last if none
+    void TileRange(float ndcMin, float ndcMax, std::uint32_t tiles, std::uint32_t &first, std::uint32_t &last)
+    {
+        if (ndcMax < -1.0f || ndcMin > 1.0f)
+        {
+            first = 1;
+            last = 0;
+            return;
+        }
+
+        float scale = static_cast<float>(tiles);
+        first = static_cast<std::uint32_t>(std::clamp((ndcMin * 0.5f + 0.5f) * scale, 0.0f, scale - 1.0f));
+        last = static_cast<std::uint32_t>(std::clamp((ndcMax * 0.5f + 0.5f) * scale, 0.0f, scale - 1.0f));
+    }
+
+    // Smallest and largest value of (coordinate +- radius) / depth over depths in [nearDepth, farDepth]
+    void ProjectedRange(float coordinate, float radius, float nearDepth, float farDepth, float &low, float &high)
+    {
+        float lowEdge = coordinate - radius;
+        float highEdge = coordinate + radius;
+        low = lowEdge >= 0.0f ? lowEdge / farDepth : lowEdge / nearDepth;
+        high = highEdge >= 0.0f ? highEdge / nearDepth : highEdge / farDepth;
+    }
+}
+
+float LightInfluenceRadius(float brightness, float constant, float linear, float quadratic)
+{
+    // Solve quadratic * d^2 + linear * d + (constant - brightness / cutoff) = 0 for d
+    float c = constant - brightness / LIGHT_CUTOFF;
+    if (c >= 0.0f)
+        return 0.0f;
+
+    if (quadratic > 0.0f)
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+    if (linear > 0.0f)
+        return -c / linear;
+    return std::numeric_limits<float>::infinity();
+}
+
+void LightClusters::SetFrustum(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    float tanHalfFovY = std::tan(fovY * 0.5f);
+    if (!mBounds.empty() && tanHalfFovY == mTanHalfFovY && aspect == mAspect && nearPlane == mNear && farPlane == mFar)
+        return;
+
+    mTanHalfFovY = tanHalfFovY;
+    mAspect = aspect;
+    mNear = nearPlane;
+    mFar = farPlane;
+    mSliceScale = static_cast<float>(DEPTH_SLICES - 1) / std::log(farPlane / FIRST_SLICE_DEPTH);
+
+    const float tanHalfFovX = tanHalfFovY * aspect;
+    mBounds.resize(CLUSTER_COUNT);
+    for (std::uint32_t slice = 0; slice < DEPTH_SLICES; ++slice)
+    {
+        float depths[2] = {SliceDepth(slice), SliceDepth(slice + 1)};
+
+        // Widened a little so points on a boundary fall inside whichever cluster the
+        // shader's rounding picks
+        float margin = depths[1] * 1e-4f;
+
+        for (std::uint32_t y = 0; y < TILES_Y; ++y)
+        {
+            for (std::uint32_t x = 0; x < TILES_X; ++x)
+            {
+                float ndcX[2] = {2.0f * x / TILES_X - 1.0f, 2.0f * (x + 1) / TILES_X - 1.0f};
+                float ndcY[2] = {2.0f * y / TILES_Y - 1.0f, 2.0f * (y + 1) / TILES_Y - 1.0f};
+
+                AABB bounds = AABB::Empty();
+                for (float depth : depths)
+                {
+                    for (float nx : ndcX)
+                    {
+                        for (float ny : ndcY)
+                            bounds.Grow(glm::vec3(nx * tanHalfFovX * depth, ny * tanHalfFovY * depth, -depth));
+                    }
+                }
+                mBounds[(slice * TILES_Y + y) * TILES_X + x] = bounds.Expanded(margin);
+            }
+        }
+    }
+}
+
+std::uint32_t LightClusters::SliceOf(float depth) const
+{
+    if (depth < FIRST_SLICE_DEPTH)
+        return 0;
+
+    float slice = std::log(depth / FIRST_SLICE_DEPTH) * mSliceScale + 1.0f;
+    return std::min(static_cast<std::uint32_t>(slice), DEPTH_SLICES - 1);
+}
+
+float LightClusters::SliceDepth(std::uint32_t slice) const
+{
+    if (slice == 0)
+        return mNear;
+    if (slice >= DEPTH_SLICES)
+        return mFar;
+    return FIRST_SLICE_DEPTH * std::exp(static_cast<float>(slice - 1) / mSliceScale);
+}
+
+std::uint32_t LightClusters::ClusterOf(const glm::vec3 &position) const
+{
+    float depth = -position.z;
+    float ndcX = position.x / (depth * mTanHalfFovY * mAspect);
+    float ndcY = position.y / (depth * mTanHalfFovY);
+
+    std::uint32_t x = static_cast<std::uint32_t>(std::clamp((ndcX * 0.5f + 0.5f) * TILES_X, 0.0f, TILES_X - 1.0f));
+    std::uint32_t y = static_cast<std::uint32_t>(std::clamp((ndcY * 0.5f + 0.5f) * TILES_Y, 0.0f, TILES_Y - 1.0f));
+    return (SliceOf(depth) * TILES_Y + y) * TILES_X + x;
+}
+
+void LightClusters::Assign(const ClusterLight *lights, std::size_t count, JobSystem *jobSystem)
+{
+    assert(!mBounds.empty() && "SetFrustum must be called before assigning lights.");
+    assert(count <= PAIR_LIGHT_MASK && "Too many lights to cluster.");
+
+    // Depth slices each light reaches, lights entirely in front of the near plane or
+    // past the far plane reach none
+    mLightSlices.resize(count * 2);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float depth = -lights[i].position.z;
+        float radius = lights[i].radius;
+        if (depth + radius < mNear || depth - radius > mFar)
+        {
+            mLightSlices[i * 2] = 1;
+            mLightSlices[i * 2 + 1] = 0;
+            continue;
+        }
+        mLightSlices[i * 2] = SliceOf(std::max(depth - radius, mNear));
+        mLightSlices[i * 2 + 1] = SliceOf(std::min(depth + radius, mFar));
+    }
+
+    if (count < PARALLEL_LIGHT_COUNT)
+        jobSystem = nullptr;
+
+    mCounts.assign(CLUSTER_COUNT, 0);
+    auto collect = [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t slice = begin; slice < end; ++slice)
+            CollectSlice(static_cast<std::uint32_t>(slice), lights, count);
+    };
+    if (jobSystem)
+        jobSystem->ParallelFor(0, DEPTH_SLICES, SLICES_PER_JOB, collect);
+    else
+        collect(0, DEPTH_SLICES);
+
+    mRanges.resize(CLUSTER_COUNT * 2);
+    std::uint32_t offset = 0;
+    for (std::uint32_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+    {
+        std::uint32_t lightCount = std::min(mCounts[cluster], MAX_LIGHTS_PER_CLUSTER);
+        mRanges[cluster * 2] = offset;
+        mRanges[cluster * 2 + 1] = lightCount;
+        offset += lightCount;
+    }
+    mIndices.resize(offset);
+
+    auto scatter = [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t slice = begin; slice < end; ++slice)
+            ScatterSlice(static_cast<std::uint32_t>(slice));
+    };
+    if (jobSystem)
+        jobSystem->ParallelFor(0, DEPTH_SLICES, SLICES_PER_JOB, scatter);
+    else
+        scatter(0, DEPTH_SLICES);
+}
+
+void LightClusters::CollectSlice(std::uint32_t slice, const ClusterLight *lights, std::size_t count)
+{
+    std::vector<std::uint32_t> &pairs = mSlicePairs[slice];
+    pairs.clear();
+
+    const float sliceNear = SliceDepth(slice);
+    const float sliceFar = SliceDepth(slice + 1);
+    const float tanHalfFovX = mTanHalfFovY * mAspect;
+    std::uint32_t *counts = mCounts.data() + slice * TILES_PER_SLICE;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (slice < mLightSlices[i * 2] || slice > mLightSlices[i * 2 + 1])
+            continue;
+
+        const ClusterLight &light = lights[i];
+        float depth = -light.position.z;
+        float nearDepth = std::max(sliceNear, depth - light.radius);
+        float farDepth = std::min(sliceFar, depth + light.radius);
+
+        // Tiles the sphere can project into over its depth range within this slice
+        float lowX, highX, lowY, highY;
+        ProjectedRange(light.position.x, light.radius, nearDepth, farDepth, lowX, highX);
+        ProjectedRange(light.position.y, light.radius, nearDepth, farDepth, lowY, highY);
+
+        std::uint32_t firstX, lastX, firstY, lastY;
+        TileRange(lowX / tanHalfFovX, highX / tanHalfFovX, TILES_X, firstX, lastX);
+        TileRange(lowY / mTanHalfFovY, highY / mTanHalfFovY, TILES_Y, firstY, lastY);
+
+        float radiusSquared = light.radius * light.radius;
+        for (std::uint32_t y = firstY; y <= lastY; ++y)
+        {
+            for (std::uint32_t x = firstX; x <= lastX; ++x)
+            {
+                std::uint32_t tile = y * TILES_X + x;
+                if (mBounds[slice * TILES_PER_SLICE + tile].DistanceSquared(light.position) > radiusSquared)
+                    continue;
+
+                pairs.push_back(tile << 24 | static_cast<std::uint32_t>(i));
+                ++counts[tile];
+            }
+        }
+    }
+}
+
+void LightClusters::ScatterSlice(std::uint32_t slice)
+{
+    std::uint32_t cursor[TILES_PER_SLICE];
+    const std::uint32_t *ranges = mRanges.data() + slice * TILES_PER_SLICE * 2;
+    for (std::uint32_t tile = 0; tile < TILES_PER_SLICE; ++tile)
+        cursor[tile] = 0;
+
+    // Pairs were found in ascending light order, so each cluster's list is too
+    for (std::uint32_t pair : mSlicePairs[slice])
+    {
+        std::uint32_t tile = pair >> 24;
+        if (cursor[tile] == ranges[tile * 2 + 1])
+            continue;
+
+        mIndices[ranges[tile * 2] + cursor[tile]++] = pair & PAIR_LIGHT_MASK;
+    }
+}
@@ -48,4 +48,24 @@ void Mesh::Draw() const
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
+}
+
+void Mesh::DrawInstanced(GLsizei count, unsigned int instanceBuffer, std::size_t offset) const
+{
+    glBindVertexArray(VAO);
+
+    // GL 3.3 has no base instance, so the matrix columns are pointed at the batch instead.
+    // Shaders without instance attributes ignore them, so they can stay enabled.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        GLuint location = INSTANCE_MATRIX_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0, count);
+    glBindVertexArray(0);
 }
\ No newline at end of file
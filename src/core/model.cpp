@@ -42,6 +42,11 @@ std::unique_ptr<Mesh> Model::processMesh(aiMesh *mesh, const aiScene *scene, boo
     std::vector<Vertex> vertices = loadVertices(mesh);
     std::vector<unsigned int> indices = loadIndices(mesh);
 
+    for (const Vertex &vertex : vertices)
+    {
+        bounds.Grow(vertex.position);
+    }
+
     auto finalMesh = std::make_unique<Mesh>(vertices, indices);
     if (loadMaterials)
     {
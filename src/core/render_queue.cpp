@@ -0,0 +1,83 @@
+#include "core/render_queue.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const int PROGRAM_BITS = 12;
+    const int MATERIAL_BITS = 16;
+    const int MESH_BITS = 14;
+
+    std::uint64_t Field(std::uint64_t value, int bits)
+    {
+        return value & ((std::uint64_t(1) << bits) - 1);
+    }
+}
+
+std::uint64_t RenderQueue::MakeKey(const DrawSortHints &hints, unsigned int program, float depth)
+{
+    const std::uint64_t depthMax = (std::uint64_t(1) << DEPTH_BITS) - 1;
+    std::uint64_t quantized = static_cast<std::uint64_t>(std::clamp(depth, 0.0f, 1.0f) * depthMax);
+
+    std::uint64_t key = std::uint64_t(hints.pass) << 62;
+    if (hints.pass == RenderPass::Opaque)
+    {
+        key |= Field(program, PROGRAM_BITS) << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS);
+        key |= Field(hints.material, MATERIAL_BITS) << (MESH_BITS + DEPTH_BITS);
+        key |= Field(hints.mesh, MESH_BITS) << DEPTH_BITS;
+        key |= quantized;
+    }
+    else
+    {
+        key |= (depthMax - quantized) << (PROGRAM_BITS + MATERIAL_BITS + MESH_BITS);
+        key |= Field(program, PROGRAM_BITS) << (MATERIAL_BITS + MESH_BITS);
+        key |= Field(hints.material, MATERIAL_BITS) << MESH_BITS;
+        key |= Field(hints.mesh, MESH_BITS);
+    }
+    return key;
+}
+
+std::uint32_t RenderQueue::PointerKey(const void *pointer)
+{
+    // Fibonacci hashing, the high bits of the product mix every bit of the address
+    std::uint64_t address = reinterpret_cast<std::uintptr_t>(pointer);
+    return static_cast<std::uint32_t>((address * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+void RenderQueue::Sort()
+{
+    const std::size_t count = mItems.size();
+    if (count < 2)
+        return;
+
+    // Histograms of all eight bytes in one read of the keys
+    std::size_t counts[8][256];
+    std::memset(counts, 0, sizeof(counts));
+    for (const DrawItem &item : mItems)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+            ++counts[byte][(item.key >> (byte * 8)) & 0xFF];
+    }
+
+    mScratch.resize(count);
+    for (int byte = 0; byte < 8; ++byte)
+    {
+        // Every key has the same value here, e.g. the pass byte when everything is opaque
+        std::size_t *bucket = counts[byte];
+        if (bucket[(mItems[0].key >> (byte * 8)) & 0xFF] == count)
+            continue;
+
+        std::size_t offset = 0;
+        for (int value = 0; value < 256; ++value)
+        {
+            std::size_t size = bucket[value];
+            bucket[value] = offset;
+            offset += size;
+        }
+
+        for (const DrawItem &item : mItems)
+            mScratch[bucket[(item.key >> (byte * 8)) & 0xFF]++] = item;
+
+        mItems.swap(mScratch);
+    }
+}
@@ -0,0 +1,103 @@
+#include "core/uniforms.hpp"
+#include <cstdio>
+
+namespace
+{
+    // Function local so handles in other translation units can intern during static
+    // initialization. Only touched from static initialization and the render thread.
+    struct UniformNames
+    {
+        std::vector<std::string> names;
+        std::unordered_map<std::string, UniformId> ids;
+    };
+
+    UniformNames &GetUniformNames()
+    {
+        static UniformNames names;
+        return names;
+    }
+}
+
+UniformId InternUniformName(std::string_view name)
+{
+    UniformNames &registry = GetUniformNames();
+    std::string key(name);
+    auto it = registry.ids.find(key);
+    if (it != registry.ids.end())
+        return it->second;
+
+    UniformId id = static_cast<UniformId>(registry.names.size());
+    registry.names.push_back(key);
+    registry.ids.emplace(std::move(key), id);
+    return id;
+}
+
+std::vector<UniformId> InternUniformArrayNames(const char *format, std::size_t size)
+{
+    std::vector<UniformId> ids(size);
+    char name[256];
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        std::snprintf(name, sizeof(name), format, static_cast<int>(i));
+        ids[i] = InternUniformName(name);
+    }
+    return ids;
+}
+
+void BindUniformBlock(unsigned int program, const char *name, unsigned int binding)
+{
+    GLuint index = glGetUniformBlockIndex(program, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, index, binding);
+}
+
+void ProgramUniforms::Reflect(unsigned int program)
+{
+    mByName.clear();
+    mLocations.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+
+        std::string name(buffer.data(), length);
+        GLint location = glGetUniformLocation(program, name.c_str());
+
+        // Members of uniform blocks have no location
+        if (location < 0)
+            continue;
+
+        mByName[name] = location;
+
+        // Arrays are reported as their first element, e.g. "boneMatrices[0]"
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            std::string base = name.substr(0, name.size() - 3);
+            mByName[base] = location;
+            for (GLint element = 1; element < size; ++element)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                mByName[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+}
+
+void ProgramUniforms::Resolve() const
+{
+    const std::vector<std::string> &names = GetUniformNames().names;
+    for (std::size_t id = mLocations.size(); id < names.size(); ++id)
+    {
+        auto it = mByName.find(names[id]);
+        mLocations.push_back(it != mByName.end() ? it->second : -1);
+    }
+}
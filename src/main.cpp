@@ -10,6 +10,8 @@
 #include "core/model.hpp"
 #include "core/material.hpp"
 #include "core/ecs/render_system.hpp"
+#include "core/ecs/transform_system.hpp"
+#include "core/ecs/spatial_index_system.hpp"
 #include <core/texture_manager.hpp>
 #include <core/ecs/core_render_module.hpp>
 #include "pbr/pbr_material.hpp"
@@ -105,6 +107,9 @@ int main()
 
   // Register components
   coordinator->RegisterComponent<TransformComponent>();
+  coordinator->RegisterComponent<HierarchyComponent>();
+  coordinator->RegisterComponent<WorldMatrixComponent>();
+  coordinator->RegisterComponent<BoundsComponent>();
   coordinator->RegisterComponent<ModelComponent>();
   coordinator->RegisterComponent<MaterialComponent>();
   coordinator->RegisterComponent<PointLightComponent>();
@@ -115,22 +120,50 @@ int main()
   coordinator->RegisterComponent<ColliderComponent>();
   coordinator->RegisterComponent<WaterMeshComponent>();
 
+  // Systems take their signature and access from their component types, the ones
+  // that also look up other components widen their access here
+
   // Register and configure animations system
   auto animationsSystem = coordinator->RegisterSystem<AnimationsSystem>();
+  animationsSystem->Init(coordinator);
+
+  // Register and configure transform system
+  auto transformSystem = coordinator->RegisterSystem<TransformSystem>();
   {
-    Signature signature;
-    signature.set(coordinator->GetComponentType<AnimationComponent>());
-    signature.set(coordinator->GetComponentType<AnimatedModelComponent>());
-    coordinator->SetSystemSignature<AnimationsSystem>(signature);
+    Signature reads;
+    reads.set(coordinator->GetComponentType<TransformComponent>());
+    reads.set(coordinator->GetComponentType<HierarchyComponent>());
+    Signature writes;
+    writes.set(coordinator->GetComponentType<WorldMatrixComponent>());
+    coordinator->SetSystemAccess<TransformSystem>(reads, writes);
   }
-  animationsSystem->Init(coordinator);
+  transformSystem->Init(coordinator);
+
+  // Register and configure spatial index system
+  auto spatialIndexSystem = coordinator->RegisterSystem<SpatialIndexSystem>();
+  {
+    Signature reads;
+    reads.set(coordinator->GetComponentType<TransformComponent>());
+    reads.set(coordinator->GetComponentType<WorldMatrixComponent>());
+    reads.set(coordinator->GetComponentType<ModelComponent>());
+    reads.set(coordinator->GetComponentType<BoundsComponent>());
+    coordinator->SetSystemAccess<SpatialIndexSystem>(reads, Signature());
+  }
+  spatialIndexSystem->Init(coordinator);
 
   // Register and configure render system
   auto renderSystem = coordinator->RegisterSystem<RenderSystem>();
   {
-    Signature signature;
-    signature.set(coordinator->GetComponentType<TransformComponent>());
-    coordinator->SetSystemSignature<RenderSystem>(signature);
+    Signature reads;
+    reads.set(coordinator->GetComponentType<TransformComponent>());
+    reads.set(coordinator->GetComponentType<WorldMatrixComponent>());
+    reads.set(coordinator->GetComponentType<ModelComponent>());
+    reads.set(coordinator->GetComponentType<MaterialComponent>());
+    reads.set(coordinator->GetComponentType<PointLightComponent>());
+    reads.set(coordinator->GetComponentType<PBRMaterialComponent>());
+    reads.set(coordinator->GetComponentType<AnimatedModelComponent>());
+    reads.set(coordinator->GetComponentType<WaterMeshComponent>());
+    coordinator->SetSystemAccess<RenderSystem>(reads, Signature());
   }
   renderSystem->Init(coordinator, WIDTH, HEIGHT);
   renderSystem->AddModule(std::make_unique<CoreObjectModule>());
@@ -141,14 +174,21 @@ int main()
   renderSystem->postProcessPasses.push_back(std::make_unique<BloomPass>(WIDTH, HEIGHT));
   renderSystem->postProcessPasses.push_back(std::make_unique<CameraNoisePass>());
 
-  // Register and configure physics system
+  // Register physics system
   auto physicsSystem = coordinator->RegisterSystem<PhysicsSystem>();
-  {
-    Signature signature;
-    signature.set(coordinator->GetComponentType<RigidbodyComponent>());
-    signature.set(coordinator->GetComponentType<TransformComponent>());
-    coordinator->SetSystemSignature<PhysicsSystem>(signature);
-  }
+
+  // Physics and animation touch disjoint components and may overlap. World matrices are
+  // computed once physics is done, rendering waits for them and for animation.
+  coordinator->ScheduleSystem<PhysicsSystem>([&](float dt)
+                                             { physicsSystem->Update(dt); });
+  coordinator->ScheduleSystem<AnimationsSystem>([&](float dt)
+                                                { animationsSystem->Update(dt, camera); });
+  coordinator->ScheduleSystem<TransformSystem>([&](float dt)
+                                               { transformSystem->Update(); });
+  coordinator->ScheduleSystem<SpatialIndexSystem>([&](float dt)
+                                                  { spatialIndexSystem->Update(); });
+  coordinator->ScheduleSystem<RenderSystem>([&](float dt)
+                                            { renderSystem->Update(dt, camera); });
 
   // Initiate Texture Manager
   TextureManager textureManager;
@@ -169,6 +209,20 @@ int main()
   auto waterNormals = textureManager.load("assets/textures/waternormal.png");
   std::shared_ptr<WaterMesh> waterMesh = std::make_shared<WaterMesh>(200, 100, 24, waterDUDV, waterNormals);
 
+  // Names for every resource a component references, so the scene can be snapshotted
+  AssetRegistry assets;
+  assets.Register("cube", cubeModel);
+  assets.Register("skybox", skyboxModel);
+  assets.Register("vase", vaseModel);
+  assets.Register("man", manModel);
+  assets.Register("man2", manModel2);
+  assets.Register("man.animation", manAnimation);
+  assets.Register("water", waterMesh);
+  for (size_t i = 0; i < manTextures.size(); i++)
+    assets.Register("man.material" + std::to_string(i), manTextures[i]);
+  for (size_t i = 0; i < manTexturesPBR.size(); i++)
+    assets.Register("man.pbr" + std::to_string(i), manTexturesPBR[i]);
+
   // Create a cube entity
   {
     Entity cube = coordinator->CreateEntity();
@@ -176,10 +230,12 @@ int main()
     cubeTransform.translation = {0.0f, 0.0f, -5.0f};
     cubeTransform.scale = {1.0f, 1.0f, 1.0f};
     coordinator->AddComponent(cube, cubeTransform);
+    coordinator->AddComponent(cube, WorldMatrixComponent{});
     coordinator->AddComponent(cube, ModelComponent{cubeModel});
     PBRMaterialComponent cubeMat{std::make_shared<PBRMaterial>()};
     cubeMat.materials.at(0)->setAlbedo(glm::vec3(0.0f, 1.0f, 0.3f));
     cubeMat.materials.at(0)->setAlbedoMap(fireTexture);
+    assets.Register("cube.material", cubeMat.materials.at(0));
     coordinator->AddComponent(cube, cubeMat);
     auto cubeRB = std::make_shared<RigidBody>();
     cubeRB->mass = 2.0f;
@@ -196,9 +252,11 @@ int main()
     groundTransform.translation = {0.0f, -15.0f, 0.0f};
     groundTransform.scale = {80.0f, 1.0f, 80.0f};
     coordinator->AddComponent(ground, groundTransform);
+    coordinator->AddComponent(ground, WorldMatrixComponent{});
     coordinator->AddComponent(ground, ModelComponent{cubeModel});
     PBRMaterialComponent groundMat{std::make_shared<PBRMaterial>()};
     groundMat.materials.at(0)->setAlbedo(glm::vec3(0.7f, 0.45f, 0.05f));
+    assets.Register("ground.material", groundMat.materials.at(0));
     coordinator->AddComponent(ground, groundMat);
     auto groundRB = std::make_shared<RigidBody>();
     groundRB->mass = 1000.0f;
@@ -215,10 +273,12 @@ int main()
     cubeTransform.translation = {0.0f, 0.0f, 0.0f};
     cubeTransform.scale = {100.0f, 100.0f, 100.0f};
     coordinator->AddComponent(cube, cubeTransform);
+    coordinator->AddComponent(cube, WorldMatrixComponent{});
     coordinator->AddComponent(cube, ModelComponent{skyboxModel});
     PBRMaterialComponent cubeMat{std::make_shared<PBRMaterial>()};
     cubeMat.materials.at(0)->setAlbedoMap(skyTexture);
     cubeMat.materials.at(0)->ignoreLighting = true;
+    assets.Register("skybox.material", cubeMat.materials.at(0));
     coordinator->AddComponent(cube, cubeMat);
   }
 
@@ -229,6 +289,7 @@ int main()
     waterTransform.translation = {0.0f, -7.0f, 0.0f};
     waterTransform.scale = {1.0f, 1.0f, 1.0f};
     coordinator->AddComponent(water, waterTransform);
+    coordinator->AddComponent(water, WorldMatrixComponent{});
     coordinator->AddComponent(water, WaterMeshComponent{waterMesh});
   }
 
@@ -240,7 +301,9 @@ int main()
     manTransform.scale = {1.0f, 1.0f, 1.0f};
     manTransform.rotation = {0.0f, -90.0f, 0.0f};
     coordinator->AddComponent(man, manTransform);
+    coordinator->AddComponent(man, WorldMatrixComponent{});
     coordinator->AddComponent(man, AnimatedModelComponent{manModel});
+    coordinator->AddComponent(man, BoundsComponent{manModel->bounds});
     MaterialComponent manMat;
     manMat.materials = manTextures;
     coordinator->AddComponent(man, manMat);
@@ -254,7 +317,9 @@ int main()
     manTransform.scale = {1.0f, 1.0f, 1.0f};
     manTransform.rotation = {0.0f, 90.0f, 0.0f};
     coordinator->AddComponent(man, manTransform);
+    coordinator->AddComponent(man, WorldMatrixComponent{});
     coordinator->AddComponent(man, AnimatedModelComponent{manModel2});
+    coordinator->AddComponent(man, BoundsComponent{manModel2->bounds});
     PBRMaterialComponent manMat;
     manMat.materials = manTexturesPBR;
     coordinator->AddComponent(man, manMat);
@@ -271,9 +336,11 @@ int main()
     vaseTransform.scale = {7.0f, 7.0f, 7.0f};
     vaseTransform.rotation = {180.0f, 0.0f, 0.0f};
     coordinator->AddComponent(vase, vaseTransform);
+    coordinator->AddComponent(vase, WorldMatrixComponent{});
     coordinator->AddComponent(vase, ModelComponent{vaseModel});
     MaterialComponent vaseMat{std::make_shared<Material>()};
     vaseMat.materials.at(0)->setAlbedo(glm::vec3(0.9f, 0.1f, 0.1f));
+    assets.Register("vase.material", vaseMat.materials.at(0));
     coordinator->AddComponent(vase, vaseMat);
   }
 
@@ -285,13 +352,20 @@ int main()
     lightTransform.scale = {0.25f, 0.25f, 0.25f};
     lightTransform.rotation = {0.0f, 0.0f, 0.0f};
     coordinator->AddComponent(light, lightTransform);
+    coordinator->AddComponent(light, WorldMatrixComponent{});
     coordinator->AddComponent(light, ModelComponent{cubeModel});
     coordinator->AddComponent(light, PointLightComponent{});
     PBRMaterialComponent lightMat{std::make_shared<PBRMaterial>()};
     lightMat.materials.at(0)->setAlbedo(glm::vec3(1.0f, 1.0f, 1.0f));
+    assets.Register("light.material", lightMat.materials.at(0));
     coordinator->AddComponent(light, lightMat);
   }
 
+  // F5 saves the scene, F9 restores the last save
+  const std::string snapshotPath = "scene.snapshot";
+  bool saveHeld = false;
+  bool loadHeld = false;
+
   float lastTime = glfwGetTime();
   while (!glfwWindowShouldClose(window))
   {
@@ -301,17 +375,20 @@ int main()
 
     processInput(window, dt);
 
+    bool savePressed = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+    bool loadPressed = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (savePressed && !saveHeld)
+      coordinator->SaveSnapshot(snapshotPath, assets);
+    if (loadPressed && !loadHeld)
+      coordinator->LoadSnapshot(snapshotPath, assets);
+    saveHeld = savePressed;
+    loadHeld = loadPressed;
+
     glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Update physics before rendering
-    physicsSystem->Update(coordinator, dt);
-
-    // Update animations before rendering
-    animationsSystem->Update(dt, camera);
-
-    // Render
-    renderSystem->Update(dt, camera);
+    // Update physics and animations, then render
+    coordinator->RunSystems(dt);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
@@ -1,6 +1,15 @@
 #include "pbr/pbr_render_module.hpp"
 
-std::pair<std::string, std::string> PBRLightingModule::GetShaders(RenderSystem *renderSystem, Entity e) const
+namespace
+{
+  const Uniform<int> IGNORE_LIGHTING("ignoreLighting");
+
+  const Uniform<glm::vec3> MATERIAL_ALBEDO("materialAlbedo");
+  const Uniform<int> ALBEDO_MAP("albedoMap");
+  const Uniform<int> USE_ALBEDO_MAP("useAlbedoMap");
+}
+
+std::pair<std::string_view, std::string_view> PBRLightingModule::GetShaders(RenderSystem *renderSystem, Entity e) const
 {
   if (!renderSystem->gCoordinator->HasComponent<PBRMaterialComponent>(e))
   {
@@ -10,50 +19,48 @@ std::pair<std::string, std::string> PBRLightingModule::GetShaders(RenderSystem *
   return {"", "shaders/pbr_materials/pbr_shader.frag"};
 }
 
-void PBRLightingModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+void PBRLightingModule::GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const
 {
   if (!renderSystem->gCoordinator->HasComponent<PBRMaterialComponent>(e))
   {
     return;
   }
-  glUniform3fv(glGetUniformLocation(program, "viewPos"), 1, glm::value_ptr(camera.Position));
-
-  // Lighting
-  // This if statement ignores lighting for all entities with a point light component
-  if (!renderSystem->gCoordinator->HasComponent<PointLightComponent>(e))
-  {
-    glUniform1i(glGetUniformLocation(program, "ignoreLighting"), false);
 
-    int lightCount = 0;
-    for (auto const &entityLight : renderSystem->mEntities)
-    {
-      if (!(renderSystem->gCoordinator->HasComponent<PointLightComponent>(entityLight) && renderSystem->gCoordinator->HasComponent<TransformComponent>(entityLight)))
-        continue;
-
-      auto &lightTransform = renderSystem->gCoordinator->GetComponent<TransformComponent>(entityLight);
-      auto &lightComponent = renderSystem->gCoordinator->GetComponent<PointLightComponent>(entityLight);
-
-      if (lightCount >= 64)
-        break;
-
-      std::string base = "pointLights[" + std::to_string(lightCount) + "]";
+  // Keyed by the first material, meshes with other materials still bind their own
+  const auto &materials = renderSystem->gCoordinator->GetComponent<PBRMaterialComponent>(e).materials;
+  if (!materials.empty() && materials.front()->hasAlbedoMap())
+    hints.material = materials.front()->getAlbedoMap()->getID();
+}
 
-      glUniform3fv(glGetUniformLocation(program, (base + ".position").c_str()), 1, glm::value_ptr(lightTransform.translation));
-      glUniform3fv(glGetUniformLocation(program, (base + ".color").c_str()), 1, glm::value_ptr(lightComponent.color));
-      glUniform1f(glGetUniformLocation(program, (base + ".intensity").c_str()), lightComponent.intensity);
-      glUniform1f(glGetUniformLocation(program, (base + ".constant").c_str()), lightComponent.constant);
-      glUniform1f(glGetUniformLocation(program, (base + ".linear").c_str()), lightComponent.linear);
-      glUniform1f(glGetUniformLocation(program, (base + ".quadratic").c_str()), lightComponent.quadratic);
+bool PBRLightingModule::CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const
+{
+  bool firstHasMaterial = renderSystem->gCoordinator->HasComponent<PBRMaterialComponent>(first);
+  if (firstHasMaterial != renderSystem->gCoordinator->HasComponent<PBRMaterialComponent>(other))
+  {
+    return false;
+  }
+  if (!firstHasMaterial)
+  {
+    return true;
+  }
 
-      lightCount++;
-    }
+  // Same material objects, and both lit or both lights
+  return renderSystem->gCoordinator->GetComponent<PBRMaterialComponent>(first).materials ==
+             renderSystem->gCoordinator->GetComponent<PBRMaterialComponent>(other).materials &&
+         renderSystem->gCoordinator->HasComponent<PointLightComponent>(first) ==
+             renderSystem->gCoordinator->HasComponent<PointLightComponent>(other);
+}
 
-    glUniform1i(glGetUniformLocation(program, "numPointLights"), lightCount);
-  }
-  else
+void PBRLightingModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+{
+  if (!renderSystem->gCoordinator->HasComponent<PBRMaterialComponent>(e))
   {
-    glUniform1i(glGetUniformLocation(program, "ignoreLighting"), true);
+    return;
   }
+  // Camera and lights come from the pass uniform blocks, see RenderSystem::UploadPassUniforms
+  // Lighting is ignored for all entities with a point light component
+  bool isLight = renderSystem->gCoordinator->HasComponent<PointLightComponent>(e);
+  IGNORE_LIGHTING.Set(renderSystem->GetUniforms(program), isLight);
 }
 
 void PBRLightingModule::UploadMeshUniforms(unsigned int program, RenderSystem *renderSystem, Entity e, int materialID)
@@ -93,22 +100,23 @@ void PBRLightingModule::UploadMeshUniforms(unsigned int program, RenderSystem *r
       texture = material->getAlbedoMap();
   }
 
-  glUniform3fv(glGetUniformLocation(program, "materialAlbedo"), 1, glm::value_ptr(albedo));
+  const ProgramUniforms &uniforms = renderSystem->GetUniforms(program);
+  MATERIAL_ALBEDO.Set(uniforms, albedo);
   if (material->ignoreLighting)
   {
-    glUniform1i(glGetUniformLocation(program, "ignoreLighting"), GL_TRUE);
+    IGNORE_LIGHTING.Set(uniforms, GL_TRUE);
   }
 
   // Bind the texture
   if (texture)
   {
     unsigned int slot = 0; // Use slot 0 for base textures
-    texture->bind(slot);
-    glUniform1i(glGetUniformLocation(program, "albedoMap"), slot);
-    glUniform1i(glGetUniformLocation(program, "useAlbedoMap"), true);
+    renderSystem->BindTexture(slot, texture->getID());
+    ALBEDO_MAP.Set(uniforms, static_cast<int>(slot));
+    USE_ALBEDO_MAP.Set(uniforms, true);
   }
   else
   {
-    glUniform1i(glGetUniformLocation(program, "useAlbedoMap"), false);
+    USE_ALBEDO_MAP.Set(uniforms, false);
   }
 }
\ No newline at end of file
@@ -1,8 +1,33 @@
 #include "water/water_render_module.hpp"
 #include "water/water_mesh.hpp"
-#include <GLFW/glfw3.h>
+#include <algorithm>
 
-std::pair<std::string, std::string> WaterModule::GetShaders(RenderSystem *renderSystem, Entity e) const
+namespace
+{
+  // Size of the waves array in the water shader
+  const int MAX_WAVES = 32;
+
+  const Uniform<glm::mat4> MODEL("model");
+
+  const Uniform<glm::vec3> SUN_DIR("sunDir");
+  const Uniform<glm::vec3> SUN_COLOR("sunColor");
+  const Uniform<glm::vec3> DEEP_COLOR("deepColor");
+  const Uniform<float> FOAM_THRESHOLD("foamThreshold");
+
+  const Uniform<int> NUM_WAVES("numWaves");
+  const UniformArray<glm::vec2> WAVE_DIR("waves[%d].dir", MAX_WAVES);
+  const UniformArray<float> WAVE_WAVELENGTH("waves[%d].wavelength", MAX_WAVES);
+  const UniformArray<float> WAVE_AMPLITUDE("waves[%d].amplitude", MAX_WAVES);
+  const UniformArray<float> WAVE_SPEED("waves[%d].speed", MAX_WAVES);
+  const UniformArray<float> WAVE_STEEPNESS("waves[%d].steepness", MAX_WAVES);
+
+  const Uniform<int> REFLECTION_TEX("reflectionTex");
+  const Uniform<int> REFRACTION_TEX("refractionTex");
+  const Uniform<int> DUDV_MAP("dudvMap");
+  const Uniform<int> NORMAL_MAP("normalMap");
+}
+
+std::pair<std::string_view, std::string_view> WaterModule::GetShaders(RenderSystem *renderSystem, Entity e) const
 {
   if (!renderSystem->gCoordinator->HasComponent<WaterMeshComponent>(e))
   {
@@ -12,61 +37,66 @@ std::pair<std::string, std::string> WaterModule::GetShaders(RenderSystem *render
   return {"shaders/water_shader/water.vert", "shaders/water_shader/water.frag"};
 }
 
-void WaterModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+void WaterModule::GetSortHints(RenderSystem *renderSystem, Entity e, DrawSortHints &hints) const
 {
   if (!renderSystem->gCoordinator->HasComponent<WaterMeshComponent>(e))
   {
     return;
   }
 
-  glm::mat4 view = camera.getViewMatrix();
-  glm::mat4 proj = camera.getProjectionMatrix(16.0f / 12.0f);
+  const auto &water = renderSystem->gCoordinator->GetComponent<WaterMeshComponent>(e);
+  hints.material = water.water->waterDUDV->getID();
+  hints.mesh = RenderQueue::PointerKey(water.water.get());
+}
 
-  glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-  glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+bool WaterModule::CanInstance(RenderSystem *renderSystem, Entity first, Entity other) const
+{
+  // The water shader has no instanced variant
+  return !renderSystem->gCoordinator->HasComponent<WaterMeshComponent>(first) &&
+         !renderSystem->gCoordinator->HasComponent<WaterMeshComponent>(other);
+}
 
-  const auto water = renderSystem->gCoordinator->GetComponent<WaterMeshComponent>(e);
+void WaterModule::UploadObjectUniforms(unsigned int program, RenderSystem *renderSystem, const Camera &camera, Entity e)
+{
+  if (!renderSystem->gCoordinator->HasComponent<WaterMeshComponent>(e))
+  {
+    return;
+  }
+
+  // Camera and time come from the frame uniform block
+  const ProgramUniforms &uniforms = renderSystem->GetUniforms(program);
+
+  const auto &water = renderSystem->gCoordinator->GetComponent<WaterMeshComponent>(e);
   const WaterMaterial &material = water.water->material;
 
-  glUniform3fv(glGetUniformLocation(program, "cameraPos"), 1, glm::value_ptr(camera.Position));
-  glUniform3fv(glGetUniformLocation(program, "sunDir"), 1, glm::value_ptr(material.sunDir));
-  glUniform3fv(glGetUniformLocation(program, "sunColor"), 1, glm::value_ptr(material.sunColor));
-  glUniform3fv(glGetUniformLocation(program, "deepColor"), 1, glm::value_ptr(material.deepColor));
-  glUniform1f(glGetUniformLocation(program, "foamThreshold"), material.foamThreshold);
+  SUN_DIR.Set(uniforms, material.sunDir);
+  SUN_COLOR.Set(uniforms, material.sunColor);
+  DEEP_COLOR.Set(uniforms, material.deepColor);
+  FOAM_THRESHOLD.Set(uniforms, material.foamThreshold);
 
   const std::vector<WaterWave> &waves = water.water->waves;
-  int numWaves = static_cast<int>(waves.size());
-  if (numWaves > 32) // 32 is the shader limit
-    numWaves = 32;
+  int numWaves = std::min(static_cast<int>(waves.size()), MAX_WAVES);
 
-  glUniform1i(glGetUniformLocation(program, "numWaves"), numWaves);
+  NUM_WAVES.Set(uniforms, numWaves);
 
   for (int i = 0; i < numWaves; i++)
   {
     const WaterWave &w = waves[i];
 
-    std::string prefix = "waves[" + std::to_string(i) + "].";
-
-    glUniform2fv(glGetUniformLocation(program, (prefix + "dir").c_str()), 1, glm::value_ptr(w.direction));
-    glUniform1f(glGetUniformLocation(program, (prefix + "wavelength").c_str()), w.wavelength);
-    glUniform1f(glGetUniformLocation(program, (prefix + "amplitude").c_str()), w.amplitude);
-    glUniform1f(glGetUniformLocation(program, (prefix + "speed").c_str()), w.speed);
-    glUniform1f(glGetUniformLocation(program, (prefix + "steepness").c_str()), w.steepness);
+    WAVE_DIR.Set(uniforms, i, w.direction);
+    WAVE_WAVELENGTH.Set(uniforms, i, w.wavelength);
+    WAVE_AMPLITUDE.Set(uniforms, i, w.amplitude);
+    WAVE_SPEED.Set(uniforms, i, w.speed);
+    WAVE_STEEPNESS.Set(uniforms, i, w.steepness);
   }
 
-  float time = static_cast<float>(glfwGetTime());
-  glUniform1f(glGetUniformLocation(program, "time"), time);
-
   if (!renderSystem->gCoordinator->HasComponent<TransformComponent>(e))
   {
-    glm::mat4 defaultModel(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(defaultModel));
+    MODEL.Set(uniforms, glm::mat4(1.0f));
     return;
   }
 
-  auto &transform = renderSystem->gCoordinator->GetComponent<TransformComponent>(e);
-  glm::mat4 model = transform.GetMatrix();
-  glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+  MODEL.Set(uniforms, renderSystem->GetModelMatrix(e));
 
   auto it = offscreenObjects.textures.find("colorTexReflection");
   auto it2 = offscreenObjects.textures.find("colorTexRefraction");
@@ -75,19 +105,17 @@ void WaterModule::UploadObjectUniforms(unsigned int program, RenderSystem *rende
     return;
   }
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, offscreenObjects.textures.at("colorTexReflection"));
-  glUniform1i(glGetUniformLocation(program, "reflectionTex"), 0);
+  renderSystem->BindTexture(0, it->second);
+  REFLECTION_TEX.Set(uniforms, 0);
 
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, offscreenObjects.textures.at("colorTexRefraction"));
-  glUniform1i(glGetUniformLocation(program, "refractionTex"), 1);
+  renderSystem->BindTexture(1, it2->second);
+  REFRACTION_TEX.Set(uniforms, 1);
 
-  water.water->waterDUDV->bind(2);
-  glUniform1i(glGetUniformLocation(program, "dudvMap"), 2);
+  renderSystem->BindTexture(2, water.water->waterDUDV->getID());
+  DUDV_MAP.Set(uniforms, 2);
 
-  water.water->waterNormals->bind(3);
-  glUniform1i(glGetUniformLocation(program, "normalMap"), 3);
+  renderSystem->BindTexture(3, water.water->waterNormals->getID());
+  NORMAL_MAP.Set(uniforms, 3);
 }
 
 void WaterModule::UploadMeshUniforms(unsigned int program, RenderSystem *renderSystem, Entity e, int materialID)
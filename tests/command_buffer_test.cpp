@@ -0,0 +1,77 @@
+// Coordinator::Flush replaying commands recorded after an entity's Destroy in the same buffer.
+// Those commands must be dropped instead of reaching the component arrays or the systems.
+//   g++ -std=c++17 -g -pthread -IInclude -I<glm> tests/command_buffer_test.cpp src/core/ecs/snapshot.cpp src/core/job_system.cpp -o command_buffer_test
+
+#include "core/ecs/command_buffer.hpp"
+#include "core/ecs/coordinator.hpp"
+#include <cassert>
+#include <cstdio>
+
+struct Position
+{
+    float x;
+};
+
+struct Velocity
+{
+    float x;
+};
+
+class MovementSystem : public System<Position, Velocity>
+{
+};
+
+int main()
+{
+    Coordinator coordinator;
+    coordinator.Init();
+    coordinator.RegisterComponent<Position>();
+    coordinator.RegisterComponent<Velocity>();
+    auto movement = coordinator.RegisterSystem<MovementSystem>();
+
+    int added = 0;
+    coordinator.OnAdd<Velocity>([&added](Entity, Velocity &)
+                                { ++added; });
+
+    Entity entity = coordinator.CreateEntity();
+    coordinator.AddComponent(entity, Position{1.0f});
+    Entity survivor = coordinator.CreateEntity();
+    coordinator.AddComponent(survivor, Position{2.0f});
+
+    CommandBuffer buffer;
+
+    // Existing entity: changes before the destroy apply, changes after it are dropped
+    buffer.AddComponent(entity, Velocity{1.0f});
+    buffer.DestroyEntity(entity);
+    buffer.AddComponent(entity, Velocity{2.0f});
+    buffer.RemoveComponent<Position>(entity);
+    buffer.DestroyEntity(entity);
+
+    // Deferred entity destroyed before components are added to it
+    DeferredEntity deferred = buffer.CreateEntity();
+    buffer.AddComponent(deferred, Position{3.0f});
+    buffer.DestroyEntity(deferred);
+    buffer.AddComponent(deferred, Velocity{3.0f});
+    buffer.RemoveComponent<Position>(deferred);
+
+    // An unrelated entity in the same buffer is still changed
+    buffer.AddComponent(survivor, Velocity{4.0f});
+
+    coordinator.Flush(buffer);
+
+    assert(!coordinator.IsAlive(entity));
+    assert(coordinator.View<Velocity>().SizeHint() == 1);
+    assert(coordinator.HasComponent<Velocity>(survivor));
+    assert(coordinator.GetComponent<Velocity>(survivor).x == 4.0f);
+    assert(added == 2 && "Only the Velocity added before the destroy and the survivor's are constructed.");
+
+    assert(movement->mEntities.Size() == 1);
+    assert(movement->mEntities.Contains(survivor));
+
+    // The freed slots are reusable and start out empty
+    Entity reused = coordinator.CreateEntity();
+    assert(!coordinator.HasComponent<Position>(reused) && !coordinator.HasComponent<Velocity>(reused));
+
+    std::printf("command buffer test passed\n");
+    return 0;
+}